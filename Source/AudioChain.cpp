@@ -0,0 +1,196 @@
+//
+//  AudioChain.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "AudioChain.hpp"
+#include "NullAudioDevice.hpp"
+#include "PluginWindow.hpp"
+#include "Tracer.hpp"
+
+const String AudioChain::mainName("Main");
+
+AudioChain::AudioChain(const String& name_, AudioPluginFormatManager& formatManager, AudioChain* mainChain_)
+    : name(name_),
+      mainChain(mainChain_),
+      ownSettings(createSettings(name_, mainChain_)),
+      settings(ownSettings != nullptr ? *ownSettings : *getAppProperties().getUserSettings()),
+      scenes(formatManager, settings),
+      bufferSizeTuner(deviceManager, player, settings),
+      recorder(settings)
+{
+    // Audio device setup, with the null device registered after the platform types
+    deviceManager.getAvailableDeviceTypes();
+    deviceManager.addAudioDeviceType(std::make_unique<NullAudioIODeviceType>(settings, isMain() ? String() : name));
+
+    // New chains start on the second stereo pair of the main device, former -multi-instance ones on their device
+    sharing = !isMain() && settings.getBoolValue("sharesMainDevice", !settings.containsKey("audioDeviceState"));
+    channelPair = settings.getIntValue("channelPair", 2);
+    if (!sharing)
+        openOwnDevice();
+
+    scenes.setMidiInput(&midiInput);
+    scenes.onSceneChanging = [this]
+    {
+        ++*nodeGeneration;
+        closeWindows();
+    };
+    player.setProcessor(&scenes);
+    player.setRecordingTap(&recorder);
+    attach();
+    deviceManager.addChangeListener(this);
+
+    scenes.restore(isMain());
+}
+
+AudioChain::~AudioChain()
+{
+    ++*nodeGeneration;
+    deviceManager.removeChangeListener(this);
+    detach();
+    closeWindows();
+    player.setRecordingTap(nullptr);
+    player.setProcessor(nullptr);
+    deviceManager.closeAudioDevice();
+}
+
+std::unique_ptr<PropertiesFile> AudioChain::createSettings(const String& name, AudioChain* mainChain)
+{
+    if (mainChain == nullptr)
+        return nullptr;
+
+    PropertiesFile::Options options;
+    options.applicationName     = JUCEApplication::getInstance()->getApplicationName();
+    options.filenameSuffix      = name + ".settings";
+    options.osxLibrarySubFolder = "Preferences";
+    return std::make_unique<PropertiesFile>(options);
+}
+
+void AudioChain::saveSettings()
+{
+    const TraceScope trace("saveIfNeeded");
+    settings.saveIfNeeded();
+}
+
+void AudioChain::openOwnDevice()
+{
+    std::unique_ptr<XmlElement> savedAudioState(settings.getXmlValue("audioDeviceState"));
+    String audioError = deviceManager.initialise(256, 256, savedAudioState.get(), true);
+
+    // Fall back to the null device on machines without audio hardware
+    if (JUCEApplicationBase::getCommandLineParameterArray().contains("-null-device")
+        || audioError.isNotEmpty() || deviceManager.getCurrentAudioDevice() == nullptr)
+    {
+        deviceManager.setCurrentAudioDeviceType(NullAudioIODeviceType::typeName, true);
+        if (deviceManager.getCurrentAudioDevice() == nullptr)
+        {
+            AudioDeviceManager::AudioDeviceSetup setup;
+            setup.outputDeviceName = NullAudioIODeviceType::realtimeDeviceName;
+            setup.inputDeviceName = NullAudioIODeviceType::realtimeDeviceName;
+            deviceManager.setAudioDeviceSetup(setup, true);
+        }
+    }
+}
+
+AudioDeviceManager& AudioChain::getDeviceManager() noexcept
+{
+    return sharing ? mainChain->deviceManager : deviceManager;
+}
+
+void AudioChain::attach()
+{
+    player.setChannelPair(sharing ? channelPair : -1);
+    getDeviceManager().addAudioCallback(&player);
+    getDeviceManager().addMidiInputDeviceCallback({}, &midiInput);
+}
+
+void AudioChain::detach()
+{
+    getDeviceManager().removeMidiInputDeviceCallback({}, &midiInput);
+    getDeviceManager().removeAudioCallback(&player);
+}
+
+void AudioChain::setSharingMainDevice(bool shouldShare)
+{
+    if (isMain() || shouldShare == sharing)
+        return;
+
+    detach();
+    sharing = shouldShare;
+    settings.setValue("sharesMainDevice", sharing);
+
+    if (sharing)
+        deviceManager.closeAudioDevice();
+    else
+        openOwnDevice();
+
+    attach();
+    saveSettings();
+}
+
+void AudioChain::setChannelPair(int firstChannel)
+{
+    channelPair = jmax(0, firstChannel);
+    settings.setValue("channelPair", channelPair);
+    player.setChannelPair(sharing ? channelPair : -1);
+    saveSettings();
+}
+
+AudioProcessorGraph::Node::Ptr AudioChain::getNode(int index)
+{
+    std::vector<PluginDescription> timeSorted = getChain().getTimeSortedList();
+    if (!isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        return nullptr;
+
+    return PluginChain::getNodeFor(getGraph(), timeSorted[index]);
+}
+
+PluginSlot* AudioChain::getSlot(int index)
+{
+    if (auto node = getNode(index))
+        return dynamic_cast<PluginSlot*>(node->getProcessor());
+    return nullptr;
+}
+
+void AudioChain::loadActivePlugins(bool recreateInstances)
+{
+    const TraceScope trace("loadActivePlugins");
+    ++*nodeGeneration;
+
+    if (recreateInstances)
+    {
+        closeWindows();
+        getChain().build(getGraph(), scenes.getLoadSampleRate(), scenes.getLoadBlockSize());
+        return;
+    }
+
+    // Only plugins that left the chain lose their instance and their windows
+    getChain().sync(getGraph(), scenes.getLoadSampleRate(), scenes.getLoadBlockSize(), [] (AudioProcessorGraph::Node* node)
+    {
+        PluginWindow::closeCurrentlyOpenWindowsFor(node);
+    });
+}
+
+void AudioChain::closeWindows()
+{
+    for (int i = 0; i < scenes.getNumScenes(); i++)
+        if (Scene* scene = scenes.getScene(i))
+            for (auto* node : scene->getGraph().getNodes())
+                PluginWindow::closeCurrentlyOpenWindowsFor(node);
+}
+
+void AudioChain::changeListenerCallback(ChangeBroadcaster*)
+{
+    // The player re-prepares the existing instances itself, only the new setup needs saving
+    if (sharing)
+        return;
+
+    std::unique_ptr<XmlElement> audioState(deviceManager.createStateXml());
+    if (audioState != nullptr)
+    {
+        bufferSizeTuner.addToState(*audioState);
+        settings.setValue("audioDeviceState", audioState.get());
+        saveSettings();
+    }
+}
@@ -0,0 +1,85 @@
+//
+//  AudioChain.hpp
+//  SoftHost
+//
+//  One independent chain of the host: its scenes, player, MIDI input and
+//  settings file. The main chain uses the regular settings and always owns
+//  an audio device. Other chains keep their settings in "<NAME>.settings",
+//  the same file -multi-instance=NAME uses, and either open a device of
+//  their own, rendering on that device's thread, or play a stereo pair of
+//  the main chain's device. Plugin formats and the plugin catalogue are
+//  shared by every chain.
+//
+
+#ifndef AudioChain_hpp
+#define AudioChain_hpp
+
+#include "SceneSwitcher.hpp"
+#include "BufferSizeTuner.hpp"
+#include "PluginSlot.hpp"
+
+ApplicationProperties& getAppProperties();
+
+class AudioChain : private ChangeListener
+{
+public:
+    AudioChain(const String& name, AudioPluginFormatManager& formatManager, AudioChain* mainChain = nullptr);
+    ~AudioChain() override;
+
+    static const String mainName;
+
+    const String& getName() const noexcept { return name; }
+    bool isMain() const noexcept { return mainChain == nullptr; }
+    PropertiesFile& getSettings() noexcept { return settings; }
+    void saveSettings();
+
+    // The device this chain plays on, which is the main chain's while sharing it
+    AudioDeviceManager& getDeviceManager() noexcept;
+    bool isSharingMainDevice() const noexcept { return sharing; }
+    void setSharingMainDevice(bool shouldShare);
+    int getChannelPair() const noexcept { return channelPair; }
+    void setChannelPair(int firstChannel);
+
+    SceneSwitcher& getScenes() noexcept { return scenes; }
+    BufferSizeTuner& getBufferSizeTuner() noexcept { return bufferSizeTuner; }
+    HostPlayer& getPlayer() noexcept { return player; }
+    RecordingTap& getRecorder() noexcept { return recorder; }
+    PluginChain& getChain() { return scenes.getActiveScene().getChain(); }
+    AudioProcessorGraph& getGraph() { return scenes.getActiveScene().getGraph(); }
+    AudioProcessorGraph::Node::Ptr getNode(int index);
+    PluginSlot* getSlot(int index);
+
+    // Moves on, on the message thread, whenever the active graph's plugins may have changed or the chain is gone.
+    // Lets other threads keep a node they resolved for as long as it is still the one at its index
+    std::shared_ptr<std::atomic<uint32>> getNodeGeneration() const noexcept { return nodeGeneration; }
+
+    void loadActivePlugins(bool recreateInstances = false);
+    void savePluginStates() { scenes.saveStates(); }
+    void closeWindows();
+
+private:
+    static std::unique_ptr<PropertiesFile> createSettings(const String& name, AudioChain* mainChain);
+    void openOwnDevice();
+    void attach();
+    void detach();
+    void changeListenerCallback(ChangeBroadcaster* changed) override;
+
+    const String name;
+    AudioChain* const mainChain;
+    std::unique_ptr<PropertiesFile> ownSettings;
+    PropertiesFile& settings;
+
+    AudioDeviceManager deviceManager;
+    MidiInputQueue midiInput;
+    SceneSwitcher scenes;
+    HostPlayer player;
+    BufferSizeTuner bufferSizeTuner;
+    RecordingTap recorder;
+    bool sharing = false;
+    int channelPair = 0;
+    std::shared_ptr<std::atomic<uint32>> nodeGeneration { std::make_shared<std::atomic<uint32>>(0) };
+
+    JUCE_DECLARE_NON_COPYABLE(AudioChain)
+};
+
+#endif /* AudioChain_hpp */
@@ -0,0 +1,219 @@
+//
+//  BufferSizeTuner.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "BufferSizeTuner.hpp"
+
+namespace
+{
+    const int windowSeconds = 10;
+    const double stepDownAverageLoad = 0.5;
+    const double stepDownPeakLoad = 0.7;
+    const double backOffPeakLoad = 0.9;
+    const uint32 floorHoldMilliseconds = 5 * 60 * 1000;
+
+    String percent(double load)
+    {
+        return String(roundToInt(load * 100.0)) + "%";
+    }
+}
+
+BufferSizeTuner::BufferSizeTuner(AudioDeviceManager& deviceManager_, HostPlayer& player_, PropertiesFile& settings_)
+    : deviceManager(deviceManager_),
+      player(player_),
+      settings(settings_)
+{
+    std::unique_ptr<XmlElement> savedState(settings.getXmlValue("audioDeviceState"));
+    if (savedState != nullptr)
+        if (auto* saved = savedState->getChildByName(tunedSizes.getTagName()))
+            for (auto* device : saved->getChildIterator())
+                tunedSizes.addChildElement(new XmlElement(*device));
+
+    lastDeviceKey = getDeviceKey();
+    deviceManager.addChangeListener(this);
+    setEnabled(settings.getBoolValue("autoTuneBufferSize", false));
+}
+
+BufferSizeTuner::~BufferSizeTuner()
+{
+    stopTimer();
+    deviceManager.removeChangeListener(this);
+}
+
+void BufferSizeTuner::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+    settings.setValue("autoTuneBufferSize", enabled);
+
+    if (enabled)
+    {
+        if (auto* device = deviceManager.getCurrentAudioDevice())
+            log(getDeviceKey() + ": auto-tune enabled at " + String(device->getCurrentBufferSizeSamples()) + " samples");
+        resetWindow();
+        startTimer(1000);
+    }
+    else
+    {
+        stopTimer();
+        if (logger != nullptr)
+            log("Auto-tune disabled");
+    }
+}
+
+void BufferSizeTuner::addToState(XmlElement& deviceState) const
+{
+    deviceState.deleteAllChildElementsWithTagName(tunedSizes.getTagName());
+    if (tunedSizes.getNumChildElements() > 0)
+        deviceState.addChildElement(new XmlElement(tunedSizes));
+}
+
+String BufferSizeTuner::getDeviceKey() const
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        return device->getTypeName() + "/" + device->getName();
+    return {};
+}
+
+void BufferSizeTuner::changeListenerCallback(ChangeBroadcaster*)
+{
+    const String deviceKey = getDeviceKey();
+    if (deviceKey != lastDeviceKey)
+    {
+        lastDeviceKey = deviceKey;
+        floorSize = 0;
+
+        // Another device, start from what was tuned for it last time
+        auto* device = deviceManager.getCurrentAudioDevice();
+        auto* tuned = tunedSizes.getChildByAttribute("name", deviceKey);
+        if (enabled && device != nullptr && tuned != nullptr)
+        {
+            const int bufferSize = tuned->getIntAttribute("bufferSize");
+            if (bufferSize > 0 && bufferSize != device->getCurrentBufferSizeSamples())
+                return setBufferSize(bufferSize, "restored the size tuned for this device");
+        }
+    }
+
+    resetWindow();
+}
+
+void BufferSizeTuner::resetWindow()
+{
+    window.clearQuick();
+    lastCallbacks = player.getNumCallbacks();
+    lastOverruns = player.getNumOverruns();
+    lastBusyTicks = player.getBusyTicks();
+    player.takePeakTicks();
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    lastXRuns = device != nullptr ? device->getXRunCount() : 0;
+}
+
+void BufferSizeTuner::timerCallback()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    const int64 period = player.getPeriodTicks();
+    if (device == nullptr || !device->isPlaying() || period <= 0)
+        return;
+
+    Window latest;
+    latest.callbacks = player.getNumCallbacks() - lastCallbacks;
+    latest.overruns = player.getNumOverruns() - lastOverruns;
+    latest.busyTicks = player.getBusyTicks() - lastBusyTicks;
+    latest.peakTicks = player.takePeakTicks();
+    lastCallbacks += latest.callbacks;
+    lastOverruns += latest.overruns;
+    lastBusyTicks += latest.busyTicks;
+
+    // Devices that don't count xruns report -1
+    const int xruns = device->getXRunCount();
+    latest.xruns = xruns >= 0 && lastXRuns >= 0 ? jmax(0, xruns - lastXRuns) : 0;
+    lastXRuns = xruns;
+
+    if (latest.callbacks == 0)
+        return;
+
+    window.add(latest);
+    if (window.size() > windowSeconds)
+        window.remove(0);
+
+    Array<int> sizes = device->getAvailableBufferSizes();
+    sizes.sort();
+    const int index = sizes.indexOf(device->getCurrentBufferSizeSamples());
+    if (index < 0)
+        return;
+
+    // Back off right away on any glitch or a callback that came close to one
+    const double peakLoad = static_cast<double>(latest.peakTicks) / period;
+    if (latest.overruns > 0 || latest.xruns > 0 || peakLoad > backOffPeakLoad)
+    {
+        if (index + 1 < sizes.size())
+        {
+            floorSize = sizes[index + 1];
+            floorExpiry = Time::getMillisecondCounter() + floorHoldMilliseconds;
+            setBufferSize(sizes[index + 1], String(latest.overruns) + " overruns, " + String(latest.xruns)
+                                            + " xruns, peak load " + percent(peakLoad));
+        }
+        return;
+    }
+
+    // Step down only after a whole clean window with headroom to spare
+    if (window.size() < windowSeconds || index == 0)
+        return;
+
+    int64 callbacks = 0, busyTicks = 0, peakTicks = 0;
+    for (const auto& second : window)
+    {
+        callbacks += second.callbacks;
+        busyTicks += second.busyTicks;
+        peakTicks = jmax(peakTicks, second.peakTicks);
+    }
+
+    const double averageLoad = static_cast<double>(busyTicks) / (static_cast<double>(callbacks) * period);
+    const double windowPeakLoad = static_cast<double>(peakTicks) / period;
+    if (averageLoad >= stepDownAverageLoad || windowPeakLoad >= stepDownPeakLoad)
+        return;
+
+    if (floorSize > 0 && Time::getMillisecondCounter() > floorExpiry)
+        floorSize = 0;
+
+    if (sizes[index - 1] >= floorSize)
+        setBufferSize(sizes[index - 1], "average load " + percent(averageLoad) + ", peak load "
+                                        + percent(windowPeakLoad) + " over " + String(windowSeconds) + " s");
+}
+
+void BufferSizeTuner::setBufferSize(int bufferSize, const String& reason)
+{
+    AudioDeviceManager::AudioDeviceSetup setup;
+    deviceManager.getAudioDeviceSetup(setup);
+    const int previous = setup.bufferSize;
+    setup.bufferSize = bufferSize;
+
+    const String error = deviceManager.setAudioDeviceSetup(setup, true);
+    if (error.isNotEmpty())
+    {
+        log(lastDeviceKey + ": unable to set " + String(bufferSize) + " samples, " + error);
+        return resetWindow();
+    }
+
+    auto* tuned = tunedSizes.getChildByAttribute("name", lastDeviceKey);
+    if (tuned == nullptr)
+    {
+        tuned = tunedSizes.createNewChildElement("DEVICE");
+        tuned->setAttribute("name", lastDeviceKey);
+    }
+    tuned->setAttribute("bufferSize", bufferSize);
+
+    log(lastDeviceKey + ": " + String(previous) + " -> " + String(bufferSize) + " samples, " + reason);
+    resetWindow();
+}
+
+void BufferSizeTuner::log(const String& message)
+{
+    if (logger == nullptr)
+        logger = std::make_unique<FileLogger>(settings.getFile().getSiblingFile("BufferSizeTuner.log"),
+                                              "SoftHost buffer size tuner", 256 * 1024);
+
+    logger->logMessage(Time::getCurrentTime().toString(true, true, true, true) + "  " + message);
+}
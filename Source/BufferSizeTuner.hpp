@@ -0,0 +1,64 @@
+//
+//  BufferSizeTuner.hpp
+//  SoftHost
+//
+//  Optional auto-tune of the device buffer size. Once a second it looks at
+//  the callback load measured by the player and the xruns reported by the
+//  device. It steps down to the smallest buffer size that stays glitch-free
+//  over a sliding window, and backs off as soon as a callback overruns or the
+//  load gets too close to the period. The tuned size is kept per device in
+//  the audioDeviceState XML and every decision is written to a log file.
+//
+
+#ifndef BufferSizeTuner_hpp
+#define BufferSizeTuner_hpp
+
+#include "HostPlayer.hpp"
+
+class BufferSizeTuner : private Timer, private ChangeListener
+{
+public:
+    BufferSizeTuner(AudioDeviceManager& deviceManager, HostPlayer& player, PropertiesFile& settings);
+    ~BufferSizeTuner() override;
+
+    bool isEnabled() const noexcept { return enabled; }
+    void setEnabled(bool shouldBeEnabled);
+
+    // Adds the tuned sizes to a state created by AudioDeviceManager::createStateXml()
+    void addToState(XmlElement& deviceState) const;
+
+private:
+    struct Window
+    {
+        int64 callbacks, overruns, busyTicks, peakTicks;
+        int xruns;
+    };
+
+    void timerCallback() override;
+    void changeListenerCallback(ChangeBroadcaster*) override;
+    void resetWindow();
+    void setBufferSize(int bufferSize, const String& reason);
+    void log(const String& message);
+    String getDeviceKey() const;
+
+    AudioDeviceManager& deviceManager;
+    HostPlayer& player;
+    PropertiesFile& settings;
+    bool enabled = false;
+
+    XmlElement tunedSizes { "BUFFERSIZETUNER" };
+    Array<Window> window;
+    int64 lastCallbacks = 0, lastOverruns = 0, lastBusyTicks = 0;
+    int lastXRuns = 0;
+    String lastDeviceKey;
+
+    // Sizes that glitched are not tried again for a while, load may have changed since
+    int floorSize = 0;
+    uint32 floorExpiry = 0;
+
+    std::unique_ptr<FileLogger> logger;
+
+    JUCE_DECLARE_NON_COPYABLE(BufferSizeTuner)
+};
+
+#endif /* BufferSizeTuner_hpp */
@@ -0,0 +1,335 @@
+//
+//  ChainBenchmark.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Scene.hpp"
+#include "PluginSlot.hpp"
+#include "ChainBenchmark.hpp"
+#include <iostream>
+
+namespace
+{
+    const double regressionTolerance = 0.10;
+    const int warmUpBlocks = 16;
+
+    double ticksToSeconds(int64 ticks)
+    {
+        return static_cast<double>(ticks) / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+    }
+}
+
+ChainBenchmark::ChainBenchmark(const File& outputFile_, const File& baselineFile_, double secondsPerCase_,
+                               const Array<double>& sampleRates_, const Array<int>& blockSizes_)
+    : Thread("Chain Benchmark"),
+      outputFile(outputFile_),
+      baselineFile(baselineFile_),
+      secondsPerCase(secondsPerCase_),
+      sampleRates(sampleRates_),
+      blockSizes(blockSizes_),
+      keyPrefix(Scene::getKeyPrefix(Scene::getActiveName(*getAppProperties().getUserSettings())))
+{
+    formatManager.addDefaultFormats();
+}
+
+ChainBenchmark::~ChainBenchmark()
+{
+    *alive = false;
+    stopThread(10000);
+}
+
+void ChainBenchmark::start(std::function<void(bool passed)> onFinished)
+{
+    finishedCallback = std::move(onFinished);
+    startThread();
+}
+
+bool ChainBenchmark::callOnMessageThread(std::function<void()> function)
+{
+    auto done = std::make_shared<WaitableEvent>();
+    std::shared_ptr<bool> isAlive = alive;
+
+    MessageManager::callAsync([function, done, isAlive]
+    {
+        if (*isAlive)
+            function();
+        done->signal();
+    });
+
+    while (!done->wait(50))
+        if (threadShouldExit())
+            return false;
+    return true;
+}
+
+void ChainBenchmark::run()
+{
+    PluginChain chain(formatManager, activePluginList, *getAppProperties().getUserSettings(), keyPrefix);
+    chain.restoreActivePluginList();
+
+    // Built and prepared on the message thread, where the graph rebuilds its render sequence straight away.
+    // Non-realtime, a rebuild still pending makes processBlock wait rather than time a cleared buffer
+    if (!callOnMessageThread([&] { chain.build(graph, sampleRates.getFirst(), blockSizes.getFirst()); }))
+        return;
+
+    Array<var> results;
+    for (double sampleRate : sampleRates)
+    {
+        for (int blockSize : blockSizes)
+        {
+            const bool prepared = callOnMessageThread([&]
+            {
+                graph.releaseResources();
+                graph.setNonRealtime(true);
+                graph.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+                graph.prepareToPlay(sampleRate, blockSize);
+            });
+
+            for (int signal = 0; prepared && signal < NumSignals && !threadShouldExit(); signal++)
+                results.add(runCase(static_cast<Signal>(signal), sampleRate, blockSize));
+        }
+    }
+
+    if (!callOnMessageThread([this] { graph.releaseResources(); }))
+        return;
+
+    auto* host = new DynamicObject();
+    host->setProperty("version", JUCEApplication::getInstance()->getApplicationVersion());
+    host->setProperty("os", SystemStats::getOperatingSystemName());
+    host->setProperty("cpu", SystemStats::getCpuModel());
+    host->setProperty("cores", SystemStats::getNumCpus());
+
+    auto* report = new DynamicObject();
+    report->setProperty("timestamp", Time::getCurrentTime().toISO8601(true));
+    report->setProperty("host", var(host));
+    report->setProperty("chain", describeChain());
+    report->setProperty("results", results);
+
+    var json(report);
+    if (baselineFile.existsAsFile())
+        passed = compareWithBaseline(json);
+
+    const String text = JSON::toString(json);
+    if (outputFile == File())
+        std::cout << text << std::endl;
+    else if (!outputFile.replaceWithText(text))
+        Logger::writeToLog("Benchmark: unable to write " + outputFile.getFullPathName());
+
+    MessageManager::callAsync([this] { finishedCallback(passed); });
+}
+
+var ChainBenchmark::runCase(Signal signal, double sampleRate, int blockSize)
+{
+    const int64 length = static_cast<int64>(secondsPerCase * sampleRate);
+    const int numBlocks = static_cast<int>(jmax<int64>(1, length / blockSize));
+    Array<AudioProcessorGraph::Node::Ptr> nodes = PluginChain::getProcessingOrder(graph);
+
+    // Plugins may expose side-chain buses, give every node enough channels
+    int numChannels = 2;
+    for (auto& node : nodes)
+        numChannels = jmax(numChannels, node->getProcessor()->getTotalNumInputChannels(),
+                           node->getProcessor()->getTotalNumOutputChannels());
+
+    AudioBuffer<float> buffer(numChannels, blockSize);
+    MidiBuffer midi;
+    std::vector<int64> nodeTicks(nodes.size(), 0);
+    blockTicks.assign(numBlocks, 0);
+
+    graph.reset();
+    for (int i = 0; i < jmin(numBlocks, warmUpBlocks); i++)
+    {
+        fillSignal(buffer, signal, static_cast<int64>(i) * blockSize, length, sampleRate);
+        graph.processBlock(buffer, midi);
+        midi.clear();
+    }
+
+    // Whole graph, as the device callback would run it
+    graph.reset();
+    for (int i = 0; i < numBlocks; i++)
+    {
+        fillSignal(buffer, signal, static_cast<int64>(i) * blockSize, length, sampleRate);
+        const int64 start = Time::getHighResolutionTicks();
+        graph.processBlock(buffer, midi);
+        blockTicks[i] = Time::getHighResolutionTicks() - start;
+        midi.clear();
+    }
+
+    // Node by node in chain order, to attribute the cost
+    graph.reset();
+    for (int i = 0; i < numBlocks; i++)
+    {
+        fillSignal(buffer, signal, static_cast<int64>(i) * blockSize, length, sampleRate);
+        for (int n = 0; n < nodes.size(); n++)
+        {
+            const int64 start = Time::getHighResolutionTicks();
+            nodes.getUnchecked(n)->getProcessor()->processBlock(buffer, midi);
+            nodeTicks[n] += Time::getHighResolutionTicks() - start;
+        }
+        midi.clear();
+    }
+
+    const double numSamples = static_cast<double>(numBlocks) * blockSize;
+    const double budget = blockSize / sampleRate;
+
+    int64 totalTicks = 0;
+    for (auto ticks : blockTicks)
+        totalTicks += ticks;
+
+    const double mean = ticksToSeconds(totalTicks) / numBlocks;
+    double variance = 0.0;
+    for (auto ticks : blockTicks)
+        variance += std::pow(ticksToSeconds(ticks) - mean, 2.0);
+    variance /= numBlocks;
+
+    std::vector<int64> sorted(blockTicks);
+    std::sort(sorted.begin(), sorted.end());
+    const int64 p99 = sorted[jmin(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))];
+
+    auto* blockTimes = new DynamicObject();
+    blockTimes->setProperty("meanUs", mean * 1.0e6);
+    blockTimes->setProperty("stddevUs", std::sqrt(variance) * 1.0e6);
+    blockTimes->setProperty("p99Us", ticksToSeconds(p99) * 1.0e6);
+    blockTimes->setProperty("maxUs", ticksToSeconds(sorted.back()) * 1.0e6);
+    blockTimes->setProperty("budgetUs", budget * 1.0e6);
+
+    Array<var> nodeResults;
+    for (int n = 0; n < nodes.size(); n++)
+    {
+        auto* nodeResult = new DynamicObject();
+        nodeResult->setProperty("name", nodes.getUnchecked(n)->getProcessor()->getName());
+        nodeResult->setProperty("nsPerSample", ticksToSeconds(nodeTicks[n]) * 1.0e9 / numSamples);
+        nodeResults.add(var(nodeResult));
+    }
+
+    auto* result = new DynamicObject();
+    result->setProperty("signal", toString(signal));
+    result->setProperty("sampleRate", sampleRate);
+    result->setProperty("blockSize", blockSize);
+    result->setProperty("blocks", numBlocks);
+    result->setProperty("nsPerSample", ticksToSeconds(totalTicks) * 1.0e9 / numSamples);
+    result->setProperty("realtimeFactor", (numSamples / sampleRate) / jmax(ticksToSeconds(totalTicks), 1.0e-9));
+    result->setProperty("blockTime", var(blockTimes));
+    result->setProperty("nodes", nodeResults);
+
+    Logger::writeToLog("Benchmark: " + toString(signal) + " " + String(sampleRate, 0) + " Hz / " + String(blockSize)
+                       + " samples: " + String(result->getProperty("realtimeFactor").toString()) + "x realtime");
+    return var(result);
+}
+
+void ChainBenchmark::fillSignal(AudioBuffer<float>& buffer, Signal signal, int64 position, int64 length, double sampleRate)
+{
+    buffer.clear();
+
+    switch (signal)
+    {
+        case Noise:
+            for (int channel = 0; channel < 2; channel++)
+                for (int i = 0; i < buffer.getNumSamples(); i++)
+                    buffer.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.5f);
+            break;
+
+        case Impulses:
+        {
+            // One full-scale impulse every quarter second
+            const int64 interval = static_cast<int64>(sampleRate / 4.0);
+            for (int i = 0; i < buffer.getNumSamples(); i++)
+                if ((position + i) % interval == 0)
+                    for (int channel = 0; channel < 2; channel++)
+                        buffer.setSample(channel, i, 1.0f);
+            break;
+        }
+
+        case Sweep:
+        {
+            // Exponential sine sweep from 20 Hz towards Nyquist over the case length
+            const double startFrequency = 20.0;
+            const double endFrequency = jmin(20000.0, sampleRate * 0.45);
+            const double duration = jmax<int64>(length, 1) / sampleRate;
+            const double rate = std::log(endFrequency / startFrequency);
+            for (int i = 0; i < buffer.getNumSamples(); i++)
+            {
+                const double t = (position + i) / sampleRate;
+                const double phase = MathConstants<double>::twoPi * startFrequency * duration / rate
+                                   * (std::exp(t / duration * rate) - 1.0);
+                const float value = static_cast<float>(std::sin(phase) * 0.5);
+                buffer.setSample(0, i, value);
+                buffer.setSample(1, i, value);
+            }
+            break;
+        }
+
+        case Silence:
+        default:
+            break;
+    }
+}
+
+var ChainBenchmark::describeChain()
+{
+    Array<var> chain;
+    for (auto& node : PluginChain::getProcessingOrder(graph))
+    {
+        auto* entry = new DynamicObject();
+        entry->setProperty("name", node->getProcessor()->getName());
+        if (auto* plugin = PluginSlot::getPluginFor(node->getProcessor()))
+        {
+            PluginDescription description = plugin->getPluginDescription();
+            entry->setProperty("format", description.pluginFormatName);
+            entry->setProperty("version", description.version);
+        }
+        entry->setProperty("latencySamples", node->getProcessor()->getLatencySamples());
+        chain.add(var(entry));
+    }
+    return chain;
+}
+
+bool ChainBenchmark::compareWithBaseline(const var& report)
+{
+    var baseline = JSON::parse(baselineFile);
+    if (!baseline.isObject())
+    {
+        Logger::writeToLog("Benchmark: unable to parse baseline " + baselineFile.getFullPathName());
+        return false;
+    }
+
+    bool ok = true;
+    Array<var> comparisons;
+
+    for (const auto& result : *report["results"].getArray())
+    {
+        const Array<var>* previousResults = baseline["results"].getArray();
+        if (previousResults == nullptr)
+            break;
+
+        for (const auto& previous : *previousResults)
+        {
+            if (previous["signal"] != result["signal"]
+                || static_cast<double>(previous["sampleRate"]) != static_cast<double>(result["sampleRate"])
+                || static_cast<int>(previous["blockSize"]) != static_cast<int>(result["blockSize"]))
+                continue;
+
+            const double ratio = static_cast<double>(result["nsPerSample"]) / jmax(static_cast<double>(previous["nsPerSample"]), 1.0e-9);
+            const bool regressed = ratio > 1.0 + regressionTolerance;
+            ok = ok && !regressed;
+
+            auto* comparison = new DynamicObject();
+            comparison->setProperty("signal", result["signal"]);
+            comparison->setProperty("sampleRate", result["sampleRate"]);
+            comparison->setProperty("blockSize", result["blockSize"]);
+            comparison->setProperty("ratio", ratio);
+            comparison->setProperty("regressed", regressed);
+            comparisons.add(var(comparison));
+
+            if (regressed)
+                Logger::writeToLog("Benchmark: regression " + result["signal"].toString() + " " + result["sampleRate"].toString()
+                                   + " Hz / " + result["blockSize"].toString() + " samples is " + String(ratio, 2) + "x baseline");
+            break;
+        }
+    }
+
+    if (auto* object = report.getDynamicObject())
+        object->setProperty("baseline", comparisons);
+
+    return ok;
+}
@@ -0,0 +1,73 @@
+//
+//  ChainBenchmark.hpp
+//  SoftHost
+//
+//  Headless benchmark of the active scene's chain. The graph is built the same
+//  way the tray host builds it and driven with synthetic signals across a
+//  matrix of sample rates and block sizes, without any audio device. Results
+//  are written as JSON and can be compared against an earlier run.
+//
+
+#ifndef ChainBenchmark_hpp
+#define ChainBenchmark_hpp
+
+ApplicationProperties& getAppProperties();
+
+class ChainBenchmark : private Thread
+{
+public:
+    ChainBenchmark(const File& outputFile, const File& baselineFile, double secondsPerCase,
+                   const Array<double>& sampleRates, const Array<int>& blockSizes);
+    ~ChainBenchmark() override;
+
+    void start(std::function<void(bool passed)> onFinished);
+
+    enum Signal
+    {
+        Silence = 0,
+        Noise,
+        Impulses,
+        Sweep,
+        NumSignals
+    };
+
+private:
+    void run() override;
+    bool callOnMessageThread(std::function<void()> function);
+    var runCase(Signal signal, double sampleRate, int blockSize);
+    void fillSignal(AudioBuffer<float>& buffer, Signal signal, int64 position, int64 length, double sampleRate);
+    var describeChain();
+    bool compareWithBaseline(const var& results);
+
+    AudioPluginFormatManager formatManager;
+    KnownPluginList activePluginList;
+    AudioProcessorGraph graph;
+    Random random;
+
+    File outputFile, baselineFile;
+    const double secondsPerCase;
+    Array<double> sampleRates;
+    Array<int> blockSizes;
+    const String keyPrefix;
+
+    std::vector<int64> blockTicks;
+    std::atomic<bool> passed { true };
+    std::function<void(bool)> finishedCallback;
+    std::shared_ptr<bool> alive { std::make_shared<bool>(true) };
+
+    JUCE_DECLARE_NON_COPYABLE(ChainBenchmark)
+};
+
+inline String toString(ChainBenchmark::Signal signal)
+{
+    switch (signal)
+    {
+        case ChainBenchmark::Silence:  return "silence";
+        case ChainBenchmark::Noise:    return "noise";
+        case ChainBenchmark::Impulses: return "impulses";
+        case ChainBenchmark::Sweep:    return "sweep";
+        default:                       return String();
+    }
+}
+
+#endif /* ChainBenchmark_hpp */
@@ -0,0 +1,488 @@
+//
+//  ControlServer.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ControlServer.hpp"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <poll.h>
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <sys/un.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    // A client sending more than this without a newline is dropped
+    const size_t maxLineBytes = 1 << 16;
+
+    var makeError(const String& message)
+    {
+        DynamicObject::Ptr reply = new DynamicObject();
+        reply->setProperty("ok", false);
+        reply->setProperty("error", message);
+        return reply.get();
+    }
+
+    DynamicObject::Ptr makeReply()
+    {
+        DynamicObject::Ptr reply = new DynamicObject();
+        reply->setProperty("ok", true);
+        return reply;
+    }
+
+    var describeParameter(AudioProcessorParameter& parameter, int index)
+    {
+        DynamicObject::Ptr result = new DynamicObject();
+        result->setProperty("param", index);
+        result->setProperty("name", parameter.getName(100));
+        result->setProperty("value", parameter.getValue());
+        result->setProperty("text", parameter.getCurrentValueAsText());
+        return result.get();
+    }
+}
+
+ControlServer::ControlServer(OwnedArray<AudioChain>& chains_, const File& socketFile_)
+    : Thread("Control Server"),
+      chains(chains_),
+      socketFile(socketFile_)
+{
+}
+
+ControlServer::~ControlServer()
+{
+    // Commands already on their way to the message thread are dropped from here on
+    *alive = false;
+    stopThread(2000);
+
+   #if JUCE_LINUX || JUCE_MAC
+    for (const auto& client : clients)
+        ::close(client.socket);
+    if (listener >= 0)
+    {
+        ::close(listener);
+        socketFile.deleteFile();
+    }
+   #endif
+}
+
+File ControlServer::getSocketFile(PropertiesFile& settings)
+{
+    const String path = settings.getValue("controlSocket").trim();
+    if (path.isEmpty())
+        return File();
+
+    return File::isAbsolutePath(path) ? File(path) : settings.getFile().getSiblingFile(path);
+}
+
+bool ControlServer::start()
+{
+   #if JUCE_LINUX || JUCE_MAC
+    const String path = socketFile.getFullPathName();
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (path.getNumBytesAsUTF8() >= sizeof(address.sun_path))
+    {
+        Logger::writeToLog("Control: socket path " + path + " is too long");
+        return false;
+    }
+    path.copyToUTF8(address.sun_path, sizeof(address.sun_path));
+
+    // A socket file nobody answers on is left over from a crash, one that answers belongs to another instance
+    if (socketFile.exists())
+    {
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        const bool inUse = probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0)
+            ::close(probe);
+
+        if (inUse)
+        {
+            Logger::writeToLog("Control: " + path + " is already served by another instance");
+            return false;
+        }
+        socketFile.deleteFile();
+    }
+
+    socketFile.getParentDirectory().createDirectory();
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0 || ::listen(listener, 4) != 0)
+    {
+        Logger::writeToLog("Control: unable to listen on " + path + ": " + String(strerror(errno)));
+        if (listener >= 0)
+            ::close(listener);
+        listener = -1;
+        return false;
+    }
+
+    Logger::writeToLog("Control: listening on " + path);
+    startThread();
+    return true;
+   #else
+    Logger::writeToLog("Control: Unix domain sockets are not supported on this platform");
+    return false;
+   #endif
+}
+
+void ControlServer::run()
+{
+   #if JUCE_LINUX || JUCE_MAC
+    std::vector<pollfd> polled;
+
+    while (!threadShouldExit())
+    {
+        polled.clear();
+        polled.push_back({ listener, POLLIN, 0 });
+        for (const auto& client : clients)
+            polled.push_back({ client.socket, POLLIN, 0 });
+
+        if (::poll(polled.data(), static_cast<nfds_t>(polled.size()), 100) <= 0)
+            continue;
+
+        // Served from the back, so removing a client keeps the other indexes valid
+        for (int i = static_cast<int>(polled.size()) - 1; i > 0; i--)
+        {
+            if (polled[static_cast<size_t>(i)].revents == 0)
+                continue;
+
+            Client& client = clients.getReference(i - 1);
+            if (!serve(client))
+            {
+                ::close(client.socket);
+                clients.remove(i - 1);
+            }
+        }
+
+        if ((polled[0].revents & POLLIN) != 0)
+        {
+            const int socket = ::accept(listener, nullptr, nullptr);
+            if (socket >= 0)
+            {
+               #if JUCE_MAC
+                const int noSignal = 1;
+                ::setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+               #endif
+                clients.add({ socket, {} });
+            }
+        }
+    }
+   #endif
+}
+
+bool ControlServer::serve(Client& client)
+{
+   #if JUCE_LINUX || JUCE_MAC
+    char buffer[4096];
+    const ssize_t numRead = ::recv(client.socket, buffer, sizeof(buffer), 0);
+    if (numRead <= 0)
+        return false;
+
+    client.received.append(buffer, static_cast<size_t>(numRead));
+
+    // One command per line, a reply is written for each before the next is read
+    for (;;)
+    {
+        const char* data = static_cast<const char*>(client.received.getData());
+        const char* end = data + client.received.getSize();
+        const char* newline = std::find(data, end, '\n');
+        if (newline == end)
+            break;
+
+        const String line = String::fromUTF8(data, static_cast<int>(newline - data)).trim();
+        client.received.removeSection(0, static_cast<size_t>(newline - data) + 1);
+        if (line.isEmpty())
+            continue;
+
+        var command;
+        var reply = JSON::parse(line, command).wasOk() && command.isObject() ? handle(command)
+                                                                             : makeError("expected a JSON object");
+        if (command.hasProperty("id") && reply.isObject())
+            reply.getDynamicObject()->setProperty("id", command["id"]);
+
+        if (!send(client.socket, JSON::toString(reply, true) + "\n"))
+            return false;
+    }
+
+    return client.received.getSize() <= maxLineBytes;
+   #else
+    ignoreUnused(client);
+    return false;
+   #endif
+}
+
+bool ControlServer::send(int socket, const String& line)
+{
+   #if JUCE_LINUX || JUCE_MAC
+    const char* data = line.toRawUTF8();
+    size_t remaining = line.getNumBytesAsUTF8();
+
+   #if JUCE_LINUX
+    const int flags = MSG_NOSIGNAL;
+   #else
+    const int flags = 0;
+   #endif
+
+    while (remaining > 0)
+    {
+        const ssize_t numSent = ::send(socket, data, remaining, flags);
+        if (numSent <= 0)
+            return false;
+
+        data += numSent;
+        remaining -= static_cast<size_t>(numSent);
+    }
+    return true;
+   #else
+    ignoreUnused(socket, line);
+    return false;
+   #endif
+}
+
+var ControlServer::handle(const var& command)
+{
+    if (command["cmd"].toString() == "set")
+        return handleSet(command);
+
+    return callOnMessageThread([this, command] { return handleOnMessageThread(command); });
+}
+
+var ControlServer::callOnMessageThread(std::function<var()> function)
+{
+    auto reply = std::make_shared<var>();
+    auto done = std::make_shared<WaitableEvent>();
+    std::shared_ptr<bool> isAlive = alive;
+
+    MessageManager::callAsync([function, reply, done, isAlive]
+    {
+        if (*isAlive)
+            *reply = function();
+        done->signal();
+    });
+
+    while (!done->wait(50))
+        if (threadShouldExit())
+            return makeError("shutting down");
+
+    return *reply;
+}
+
+var ControlServer::handleSet(const var& command)
+{
+    const String chainName = command["chain"].toString();
+    const int index = command.getProperty("index", -1);
+    ResolvedSlot* resolved = nullptr;
+
+    for (auto it = resolvedSlots.begin(); it != resolvedSlots.end(); ++it)
+    {
+        if (it->chain != chainName || it->index != index)
+            continue;
+
+        if (it->generation->load() == it->resolvedGeneration)
+        {
+            resolved = &*it;
+            break;
+        }
+
+        // The chain changed since, the node may be its last owner and is let go on the message thread
+        AudioProcessorGraph::Node::Ptr node = std::move(it->node);
+        MessageManager::callAsync([node] {});
+        resolvedSlots.erase(it);
+        break;
+    }
+
+    if (resolved == nullptr)
+    {
+        auto slot = std::make_shared<ResolvedSlot>();
+        const var error = callOnMessageThread([this, command, slot] { return resolveSlot(command, *slot); });
+        if (slot->node == nullptr)
+            return error.isObject() ? error : makeError("shutting down");
+
+        resolvedSlots.push_back(*slot);
+        resolved = &resolvedSlots.back();
+    }
+
+    auto* slot = dynamic_cast<PluginSlot*>(resolved->node->getProcessor());
+    const int parameterIndex = command.getProperty("param", -1);
+    if (slot == nullptr || !isPositiveAndBelow(parameterIndex, slot->getAutomatableParameters().size()))
+        return makeError("no parameter at index " + String(parameterIndex));
+    if (!command.hasProperty("value"))
+        return makeError("set needs a value from 0 to 1");
+
+    // Applied by the audio thread at the start of the plugin's next block
+    if (!slot->queueParameterChange(parameterIndex, static_cast<float>(command["value"])))
+        return makeError("parameter queue is full");
+    return makeReply().get();
+}
+
+var ControlServer::resolveSlot(const var& command, ResolvedSlot& resolved)
+{
+    AudioChain* chain = findChain(command);
+    if (chain == nullptr)
+        return makeError("no chain named " + command["chain"].toString());
+
+    const int index = command.getProperty("index", -1);
+    if (!isPositiveAndBelow(index, static_cast<int>(chain->getChain().getTimeSortedList().size())))
+        return makeError("no plugin at index " + String(index));
+
+    AudioProcessorGraph::Node::Ptr node = chain->getNode(index);
+    if (node == nullptr || dynamic_cast<PluginSlot*>(node->getProcessor()) == nullptr)
+        return makeError("plugin " + String(index) + " is not loaded");
+
+    resolved.chain = command["chain"].toString();
+    resolved.index = index;
+    resolved.node = node;
+    resolved.generation = chain->getNodeGeneration();
+    resolved.resolvedGeneration = resolved.generation->load();
+    return var();
+}
+
+AudioChain* ControlServer::findChain(const var& command)
+{
+    const String name = command["chain"].toString();
+    if (name.isEmpty())
+        return chains.getFirst();
+
+    for (auto* chain : chains)
+        if (chain->getName().equalsIgnoreCase(name))
+            return chain;
+    return nullptr;
+}
+
+var ControlServer::handleOnMessageThread(const var& command)
+{
+    const String name = command["cmd"].toString();
+    AudioChain* chain = findChain(command);
+    if (chain == nullptr)
+        return makeError("no chain named " + command["chain"].toString());
+
+    std::vector<PluginDescription> list = chain->getChain().getTimeSortedList();
+    const int size = static_cast<int>(list.size());
+    const int index = command.getProperty("index", -1);
+    DynamicObject::Ptr reply = makeReply();
+
+    if (name == "list")
+    {
+        Array<var> plugins;
+        for (int i = 0; i < size; i++)
+        {
+            PluginSlot* slot = chain->getSlot(i);
+            DynamicObject::Ptr plugin = new DynamicObject();
+            plugin->setProperty("index", i);
+            plugin->setProperty("name", list[static_cast<size_t>(i)].name);
+            plugin->setProperty("format", list[static_cast<size_t>(i)].pluginFormatName);
+            plugin->setProperty("bypassed", chain->getChain().isBypassed(list[static_cast<size_t>(i)]));
+            plugin->setProperty("loaded", slot != nullptr);
+            plugin->setProperty("parameters", slot != nullptr ? slot->getAutomatableParameters().size() : 0);
+            plugin->setProperty("latency", slot != nullptr ? slot->getLatencySamples() : 0);
+            plugins.add(plugin.get());
+        }
+
+        reply->setProperty("chain", chain->getName());
+        reply->setProperty("scene", chain->getScenes().getActiveScene().getName());
+        reply->setProperty("plugins", plugins);
+        return reply.get();
+    }
+
+    if (name == "perf")
+    {
+        HostPlayer& player = chain->getPlayer();
+        const int64 callbacks = player.getNumCallbacks();
+        const int64 budget = callbacks * player.getPeriodTicks();
+        reply->setProperty("callbacks", callbacks);
+        reply->setProperty("overruns", player.getNumOverruns());
+        reply->setProperty("load", budget > 0 ? static_cast<double>(player.getBusyTicks()) / static_cast<double>(budget) : 0.0);
+        reply->setProperty("deviceCpu", chain->getDeviceManager().getCpuUsage());
+        reply->setProperty("recordingDropped", chain->getRecorder().getNumDropped());
+
+        if (AudioIODevice* device = chain->getDeviceManager().getCurrentAudioDevice())
+        {
+            reply->setProperty("sampleRate", device->getCurrentSampleRate());
+            reply->setProperty("bufferSize", device->getCurrentBufferSizeSamples());
+            reply->setProperty("xruns", device->getXRunCount());
+        }
+
+        const LoadCost::MemoryUsage memory = LoadCost::getMemoryUsage();
+        reply->setProperty("residentBytes", memory.resident >= 0 ? var(memory.resident) : var());
+        reply->setProperty("proportionalBytes", memory.proportional >= 0 ? var(memory.proportional) : var());
+        return reply.get();
+    }
+
+    if (name == "save")
+    {
+        chain->savePluginStates();
+        chain->saveSettings();
+        return reply.get();
+    }
+
+    if (!isPositiveAndBelow(index, size))
+        return name == "bypass" || name == "move" || name == "get"
+                   ? makeError("no plugin at index " + String(index))
+                   : makeError("unknown command \"" + name + "\"");
+
+    const PluginDescription& plugin = list[static_cast<size_t>(index)];
+
+    // Chain edits follow the tray menu's own steps
+    if (name == "bypass")
+    {
+        const bool bypassed = chain->getChain().isBypassed(plugin);
+        const bool shouldBypass = command.hasProperty("value") ? static_cast<bool>(command["value"]) : !bypassed;
+        if (shouldBypass != bypassed)
+        {
+            chain->getChain().toggleBypass(index);
+            chain->saveSettings();
+            chain->savePluginStates();
+            chain->loadActivePlugins();
+        }
+        reply->setProperty("bypassed", shouldBypass);
+        return reply.get();
+    }
+
+    if (name == "move")
+    {
+        const bool up = command["direction"].toString() != "down";
+        if (up ? index == 0 : index == size - 1)
+            return makeError("plugin " + String(index) + " cannot move " + (up ? "up" : "down"));
+
+        chain->savePluginStates();
+        if (up)
+            chain->getChain().moveUp(index);
+        else
+            chain->getChain().moveDown(index);
+        chain->saveSettings();
+        chain->loadActivePlugins();
+        reply->setProperty("index", up ? index - 1 : index + 1);
+        return reply.get();
+    }
+
+    PluginSlot* slot = chain->getSlot(index);
+    if (slot == nullptr)
+        return makeError("plugin " + String(index) + " is not loaded");
+
+    const auto& parameters = slot->getAutomatableParameters();
+    const int parameterIndex = command.getProperty("param", -1);
+
+    if (name == "get")
+    {
+        if (!command.hasProperty("param"))
+        {
+            Array<var> described;
+            for (int i = 0; i < parameters.size(); i++)
+                described.add(describeParameter(*parameters.getUnchecked(i), i));
+            reply->setProperty("parameters", described);
+            return reply.get();
+        }
+
+        if (!isPositiveAndBelow(parameterIndex, parameters.size()))
+            return makeError("no parameter at index " + String(parameterIndex));
+
+        var described = describeParameter(*parameters.getUnchecked(parameterIndex), parameterIndex);
+        described.getDynamicObject()->setProperty("ok", true);
+        return described;
+    }
+
+    return makeError("unknown command \"" + name + "\"");
+}
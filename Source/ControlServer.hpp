@@ -0,0 +1,70 @@
+//
+//  ControlServer.hpp
+//  SoftHost
+//
+//  Local control API on a Unix domain socket, for scripts and control
+//  surfaces. Clients send one JSON object per line and get one back per line,
+//  see readme.md for the commands. A single thread serves every client and
+//  hands each command to the message thread, where chain edits are made the
+//  same way the tray menu makes them. Parameter changes skip the message
+//  thread: the slot is looked up there once, and from then on each change is
+//  queued to it straight from the server thread, to be applied at its next
+//  block.
+//
+
+#ifndef ControlServer_hpp
+#define ControlServer_hpp
+
+#include "AudioChain.hpp"
+
+class ControlServer : private Thread
+{
+public:
+    ControlServer(OwnedArray<AudioChain>& chains, const File& socketFile);
+    ~ControlServer() override;
+
+    // Reads "controlSocket" from the settings, empty when the server is turned off
+    static File getSocketFile(PropertiesFile& settings);
+
+    bool start();
+
+private:
+    struct Client
+    {
+        int socket;
+        MemoryBlock received;
+    };
+
+    void run() override;
+    bool serve(Client& client);
+    bool send(int socket, const String& line);
+
+    // Slot a "set" resolved on the message thread, valid while the chain's node generation stays the same
+    struct ResolvedSlot
+    {
+        String chain;
+        int index = -1;
+        AudioProcessorGraph::Node::Ptr node;
+        std::shared_ptr<std::atomic<uint32>> generation;
+        uint32 resolvedGeneration = 0;
+    };
+
+    // Runs the command on the message thread and waits for its reply, except for "set"
+    var handle(const var& command);
+    var callOnMessageThread(std::function<var()> function);
+    var handleOnMessageThread(const var& command);
+    var handleSet(const var& command);
+    var resolveSlot(const var& command, ResolvedSlot& resolved);
+    AudioChain* findChain(const var& command);
+
+    OwnedArray<AudioChain>& chains;
+    const File socketFile;
+    int listener = -1;
+    Array<Client> clients;
+    std::vector<ResolvedSlot> resolvedSlots;
+    std::shared_ptr<bool> alive { std::make_shared<bool>(true) };
+
+    JUCE_DECLARE_NON_COPYABLE(ControlServer)
+};
+
+#endif /* ControlServer_hpp */
@@ -0,0 +1,82 @@
+//
+//  HostPlayer.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "HostPlayer.hpp"
+#include "RealtimePolicy.hpp"
+#include "Tracer.hpp"
+
+void HostPlayer::audioDeviceAboutToStart(AudioIODevice* device)
+{
+    const TraceScope trace("audioDeviceAboutToStart");
+
+    const double sampleRate = device->getCurrentSampleRate();
+    if (sampleRate > 0.0)
+        periodTicks = static_cast<int64>(device->getCurrentBufferSizeSamples() / sampleRate
+                                         * Time::getHighResolutionTicksPerSecond());
+
+    if (auto* tap = recordingTap.load())
+        tap->prepare(sampleRate);
+
+    // A restarted device may call back on a new thread
+    threadConfigured = false;
+
+    AudioProcessorPlayer::audioDeviceAboutToStart(device);
+}
+
+void HostPlayer::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                                  float* const* outputChannelData, int numOutputChannels,
+                                                  int numSamples, const AudioIODeviceCallbackContext& context)
+{
+    if (!threadConfigured.exchange(true, std::memory_order_relaxed))
+    {
+        RealtimePolicy::applyToAudioThread();
+        Tracer::setAudioThread();
+    }
+
+    const int64 start = Time::getHighResolutionTicks();
+
+    {
+        const TraceScope trace("Audio Callback");
+
+        const float* const* inputs = inputChannelData;
+        float* const* outputs = outputChannelData;
+
+        const int firstChannel = channelPair.load(std::memory_order_relaxed);
+        if (firstChannel >= 0)
+        {
+            // The device manager mixes the callbacks, so everything outside the pair stays silent
+            for (int channel = 0; channel < numOutputChannels; channel++)
+                FloatVectorOperations::clear(outputChannelData[channel], numSamples);
+
+            numInputChannels = jlimit(0, 2, numInputChannels - firstChannel);
+            numOutputChannels = jlimit(0, 2, numOutputChannels - firstChannel);
+            inputs = numInputChannels > 0 ? inputChannelData + firstChannel : nullptr;
+            outputs = numOutputChannels > 0 ? outputChannelData + firstChannel : nullptr;
+        }
+
+        AudioProcessorPlayer::audioDeviceIOCallbackWithContext(inputs, numInputChannels, outputs, numOutputChannels,
+                                                               numSamples, context);
+
+        // The player works on copies, so the device input is still untouched here
+        if (auto* tap = recordingTap.load(std::memory_order_acquire))
+            tap->push(inputs, numInputChannels, outputs, numOutputChannels, numSamples);
+    }
+
+    const int64 elapsed = Time::getHighResolutionTicks() - start;
+    numCallbacks.fetch_add(1, std::memory_order_relaxed);
+    busyTicks.fetch_add(elapsed, std::memory_order_relaxed);
+
+    int64 peak = peakTicks.load(std::memory_order_relaxed);
+    while (elapsed > peak && !peakTicks.compare_exchange_weak(peak, elapsed, std::memory_order_relaxed)) {}
+
+    // Marks callbacks that used more than the whole period, to line up with UI stalls
+    const int64 period = periodTicks.load(std::memory_order_relaxed);
+    if (period > 0 && elapsed > period)
+    {
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+        Tracer::instant("Overrun");
+    }
+}
@@ -0,0 +1,48 @@
+//
+//  HostPlayer.hpp
+//  SoftHost
+//
+//  The device callback that plays the chain. It wraps AudioProcessorPlayer so
+//  the host can observe each callback on the audio thread. Chains sharing a
+//  device each play their own pair of channels.
+//
+
+#ifndef HostPlayer_hpp
+#define HostPlayer_hpp
+
+#include "RecordingTap.hpp"
+
+class HostPlayer : public AudioProcessorPlayer
+{
+public:
+    HostPlayer() = default;
+
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels,
+                                          int numSamples, const AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(AudioIODevice* device) override;
+
+    // -1 plays every channel, otherwise only the stereo pair starting at this channel
+    void setChannelPair(int firstChannel) noexcept { channelPair = firstChannel; }
+
+    // Receives the input and output of every callback once processing is done
+    void setRecordingTap(RecordingTap* tap) noexcept { recordingTap = tap; }
+
+    // Running totals for callback load monitoring, read from any thread
+    int64 getPeriodTicks() const noexcept { return periodTicks; }
+    int64 getNumCallbacks() const noexcept { return numCallbacks; }
+    int64 getNumOverruns() const noexcept { return numOverruns; }
+    int64 getBusyTicks() const noexcept { return busyTicks; }
+    int64 takePeakTicks() noexcept { return peakTicks.exchange(0); }
+
+private:
+    std::atomic<int64> periodTicks { 0 };
+    std::atomic<int> channelPair { -1 };
+    std::atomic<RecordingTap*> recordingTap { nullptr };
+    std::atomic<bool> threadConfigured { false };
+    std::atomic<int64> numCallbacks { 0 }, numOverruns { 0 }, busyTicks { 0 }, peakTicks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(HostPlayer)
+};
+
+#endif /* HostPlayer_hpp */
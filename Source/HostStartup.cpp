@@ -1,95 +1,225 @@
-#include "../JuceLibraryCode/JuceHeader.h"
-#include "IconMenu.hpp"
-
-#if ! (JUCE_PLUGINHOST_VST || JUCE_PLUGINHOST_VST3 || JUCE_PLUGINHOST_AU)
- #error "If you're building the audio plugin host, you probably want to enable VST and/or AU support"
-#endif
-
-class PluginHostApp : public JUCEApplication
-{
-public:
-    PluginHostApp() {}
-
-    void initialise(const String&) override
-    {
-        PropertiesFile::Options options;
-        options.applicationName     = getApplicationName();
-        options.filenameSuffix      = "settings";
-        options.osxLibrarySubFolder = "Preferences";
-
-        checkArguments(&options);
-
-        appProperties = std::make_unique<ApplicationProperties>();
-        appProperties->setStorageParameters(options);
-
-        LookAndFeel::setDefaultLookAndFeel(&lookAndFeel);
-
-        mainWindow = std::make_unique<IconMenu>();
-        #if JUCE_MAC
-            Process::setDockIconVisible(false);
-        #endif
-    }
-
-    void shutdown() override
-    {
-        mainWindow.reset();
-        appProperties.reset();
-        LookAndFeel::setDefaultLookAndFeel(nullptr);
-    }
-
-    void systemRequestedQuit() override
-    {
-        JUCEApplicationBase::quit();
-    }
-
-    const String getApplicationName() override       { return "SoftHost"; }
-    const String getApplicationVersion() override    { return ProjectInfo::versionString; }
-    bool moreThanOneInstanceAllowed() override       
-    {
-        StringArray multiInstance = getParameter("-multi-instance");
-        return multiInstance.size() == 2;
-    }
-
-    ApplicationCommandManager commandManager;
-    std::unique_ptr<ApplicationProperties> appProperties;
-    LookAndFeel_V3 lookAndFeel;
-
-private:
-    std::unique_ptr<IconMenu> mainWindow;
-
-    StringArray PluginHostApp::getParameter(String lookFor) 
-    {
-        StringArray parameters = getCommandLineParameterArray();
-        StringArray found;
-    
-        for (const auto& param : parameters) // Use range-based for loop
-        {
-            if (param.contains(lookFor))
-            {
-                found.add(lookFor);
-                int delimiter = param.indexOf("="); // Don't need the 0 parameter
-                if (delimiter != -1) // Check if "=" exists
-                {
-                    String val = param.substring(delimiter + 1);
-                    found.add(val);
-                    return found;
-                }
-            }
-        }
-        return found;
-    }
-
-    void checkArguments(PropertiesFile::Options *options) 
-    {
-        StringArray multiInstance = getParameter("-multi-instance");
-        if (multiInstance.size() == 2)
-            options->filenameSuffix = multiInstance[1] + "." + options->filenameSuffix;
-    }
-};
-
-
-static PluginHostApp& getApp() { return *dynamic_cast<PluginHostApp*>(JUCEApplication::getInstance()); }
-ApplicationCommandManager& getCommandManager() { return getApp().commandManager; }
-ApplicationProperties& getAppProperties() { return *getApp().appProperties; }
-
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "IconMenu.hpp"
+#include "OfflineRenderer.hpp"
+#include "ChainBenchmark.hpp"
+#include "Scene.hpp"
+#include "Tracer.hpp"
+
+#if ! (JUCE_PLUGINHOST_VST || JUCE_PLUGINHOST_VST3 || JUCE_PLUGINHOST_AU)
+ #error "If you're building the audio plugin host, you probably want to enable VST and/or AU support"
+#endif
+
+class PluginHostApp : public JUCEApplication
+{
+public:
+    PluginHostApp() {}
+
+    void initialise(const String&) override
+    {
+        PropertiesFile::Options options;
+        options.applicationName     = getApplicationName();
+        options.filenameSuffix      = "settings";
+        options.osxLibrarySubFolder = "Preferences";
+
+        checkArguments(&options);
+
+        appProperties = std::make_unique<ApplicationProperties>();
+        appProperties->setStorageParameters(options);
+
+        LookAndFeel::setDefaultLookAndFeel(&lookAndFeel);
+
+        #if JUCE_MAC
+            Process::setDockIconVisible(false);
+        #endif
+
+        if (startOfflineRender() || startBenchmark())
+            return;
+
+        mainWindow = std::make_unique<IconMenu>();
+    }
+
+    void shutdown() override
+    {
+        mainWindow.reset();
+        offlineRenderer.reset();
+        benchmark.reset();
+        appProperties.reset();
+        LookAndFeel::setDefaultLookAndFeel(nullptr);
+    }
+
+    void systemRequestedQuit() override
+    {
+        JUCEApplicationBase::quit();
+    }
+
+    void anotherInstanceStarted(const String& commandLine) override
+    {
+        // A second launch with -scene=<name> switches the running host to that scene
+        if (mainWindow == nullptr)
+            return;
+
+        for (const auto& param : StringArray::fromTokens(commandLine, true))
+            if (param.startsWith("-scene="))
+                mainWindow->switchToScene(param.fromFirstOccurrenceOf("=", false, false).unquoted());
+    }
+
+    const String getApplicationName() override       { return "SoftHost"; }
+    const String getApplicationVersion() override    { return ProjectInfo::versionString; }
+    bool moreThanOneInstanceAllowed() override       
+    {
+        StringArray multiInstance = getParameter("-multi-instance");
+        return multiInstance.size() == 2 || getParameter("-render").size() == 2 || getParameter("-benchmark").size() > 0;
+    }
+
+    ApplicationCommandManager commandManager;
+    std::unique_ptr<ApplicationProperties> appProperties;
+    LookAndFeel_V3 lookAndFeel;
+
+private:
+    std::unique_ptr<IconMenu> mainWindow;
+    std::unique_ptr<OfflineRenderer> offlineRenderer;
+    std::unique_ptr<ChainBenchmark> benchmark;
+
+    StringArray PluginHostApp::getParameter(String lookFor) 
+    {
+        StringArray parameters = getCommandLineParameterArray();
+        StringArray found;
+    
+        for (const auto& param : parameters) // Use range-based for loop
+        {
+            // Whole flags only, "-output" must not match "-null-output=FILE"
+            if (param == lookFor || param.startsWith(lookFor + "="))
+            {
+                found.add(lookFor);
+                int delimiter = param.indexOf("="); // Don't need the 0 parameter
+                if (delimiter != -1) // Check if "=" exists
+                {
+                    String val = param.substring(delimiter + 1);
+                    found.add(val);
+                    return found;
+                }
+            }
+        }
+        return found;
+    }
+
+    void checkArguments(PropertiesFile::Options *options) 
+    {
+        StringArray multiInstance = getParameter("-multi-instance");
+        if (multiInstance.size() == 2)
+            options->filenameSuffix = multiInstance[1] + "." + options->filenameSuffix;
+    }
+
+    // Render and benchmark runs load the active scene, an unknown name would leave them an empty chain
+    bool checkActiveScene(const String& mode)
+    {
+        PropertiesFile& settings = *appProperties->getUserSettings();
+        const String scene = Scene::getActiveName(settings);
+        if (Scene::exists(settings, scene))
+            return true;
+
+        Logger::writeToLog(mode + ": no scene named \"" + scene + "\"");
+        return false;
+    }
+
+    // -render=<file|folder>[;...] [-output=<folder>] [-jobs=N] [-block=N]
+    bool startOfflineRender()
+    {
+        StringArray render = getParameter("-render");
+        if (render.size() != 2)
+            return false;
+
+        StringArray output = getParameter("-output");
+        StringArray jobs = getParameter("-jobs");
+        StringArray block = getParameter("-block");
+
+        File outputDirectory = File::getCurrentWorkingDirectory();
+        if (output.size() == 2)
+            outputDirectory = outputDirectory.getChildFile(output[1].unquoted());
+        int numWorkers = jobs.size() == 2 ? jobs[1].getIntValue() : SystemStats::getNumCpus();
+        int blockSize = block.size() == 2 ? block[1].getIntValue() : 4096;
+
+        if (!checkActiveScene("Render"))
+        {
+            setApplicationReturnValue(1);
+            quit();
+            return true;
+        }
+
+        offlineRenderer = std::make_unique<OfflineRenderer>(OfflineRenderer::findInputFiles(render[1]), outputDirectory,
+                                                            jmax(1, numWorkers), jlimit(32, 65536, blockSize));
+        offlineRenderer->start([this] (int numFailed)
+        {
+            setApplicationReturnValue(numFailed > 0 ? 1 : 0);
+            quit();
+        });
+        return true;
+    }
+
+    // -benchmark[=<file>] [-bench-baseline=<file>] [-bench-seconds=N] [-bench-rates=A,B] [-bench-blocks=A,B]
+    bool startBenchmark()
+    {
+        StringArray bench = getParameter("-benchmark");
+        if (bench.size() == 0)
+            return false;
+
+        StringArray baseline = getParameter("-bench-baseline");
+        StringArray seconds = getParameter("-bench-seconds");
+        StringArray rates = getParameter("-bench-rates");
+        StringArray blocks = getParameter("-bench-blocks");
+
+        File outputFile, baselineFile;
+        if (bench.size() == 2)
+            outputFile = File::getCurrentWorkingDirectory().getChildFile(bench[1].unquoted());
+        if (baseline.size() == 2)
+            baselineFile = File::getCurrentWorkingDirectory().getChildFile(baseline[1].unquoted());
+
+        Array<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+        if (rates.size() == 2)
+        {
+            sampleRates.clear();
+            for (const auto& rate : StringArray::fromTokens(rates[1], ",", ""))
+                if (rate.getDoubleValue() > 0.0)
+                    sampleRates.add(rate.getDoubleValue());
+        }
+
+        Array<int> blockSizes { 64, 128, 256, 512, 1024 };
+        if (blocks.size() == 2)
+        {
+            blockSizes.clear();
+            for (const auto& block : StringArray::fromTokens(blocks[1], ",", ""))
+                if (block.getIntValue() > 0)
+                    blockSizes.add(block.getIntValue());
+        }
+
+        if (sampleRates.isEmpty() || blockSizes.isEmpty() || !checkActiveScene("Benchmark"))
+        {
+            setApplicationReturnValue(1);
+            quit();
+            return true;
+        }
+
+        benchmark = std::make_unique<ChainBenchmark>(outputFile, baselineFile,
+                                                     seconds.size() == 2 ? jmax(0.1, seconds[1].getDoubleValue()) : 5.0,
+                                                     sampleRates, blockSizes);
+        benchmark->start([this] (bool passed)
+        {
+            setApplicationReturnValue(passed ? 0 : 1);
+            quit();
+        });
+        return true;
+    }
+};
+
+
+static PluginHostApp& getApp() { return *dynamic_cast<PluginHostApp*>(JUCEApplication::getInstance()); }
+ApplicationCommandManager& getCommandManager() { return getApp().commandManager; }
+ApplicationProperties& getAppProperties() { return *getApp().appProperties; }
+
+void saveAppProperties()
+{
+    const TraceScope trace("saveIfNeeded");
+    getAppProperties().saveIfNeeded();
+}
+
 START_JUCE_APPLICATION(PluginHostApp)
\ No newline at end of file
@@ -1,628 +1,897 @@
-//
-//  IconMenu.cpp
-//  SoftHost
-//
-//  Created by Rolando Islas on 12/26/15.
-//  Updated and optimized on 04/10/25.
-//
-
-#include "../JuceLibraryCode/JuceHeader.h"
-#include "IconMenu.hpp"
-#include "PluginWindow.hpp"
-#include <ctime>
-#include <limits.h>
-#if JUCE_WINDOWS
-#include "Windows.h"
-#endif
-
-class IconMenu::PluginListWindow : public DocumentWindow
-{
-public:
-    PluginListWindow(IconMenu& owner_, AudioPluginFormatManager& pluginFormatManager)
-        : DocumentWindow("Available Plugins", Colours::white,
-            DocumentWindow::minimiseButton | DocumentWindow::closeButton),
-        owner(owner_)
-    {
-        const File deadMansPedalFile(getAppProperties().getUserSettings()
-            ->getFile().getSiblingFile("RecentlyCrashedPluginsList"));
-
-        setContentOwned(new PluginListComponent(pluginFormatManager,
-            owner.knownPluginList,
-            deadMansPedalFile,
-            getAppProperties().getUserSettings()), true);
-
-        setUsingNativeTitleBar(true);
-        setResizable(true, false);
-        setResizeLimits(300, 400, 800, 1500);
-        setTopLeftPosition(60, 60);
-
-        restoreWindowStateFromString(getAppProperties().getUserSettings()->getValue("listWindowPos"));
-        setVisible(true);
-    }
-
-    ~PluginListWindow() override
-    {
-        getAppProperties().getUserSettings()->setValue("listWindowPos", getWindowStateAsString());
-        clearContentComponent();
-    }
-
-    void closeButtonPressed() override
-    {
-        owner.removePluginsLackingInputOutput();
-        #if JUCE_MAC
-        Process::setDockIconVisible(false);
-        #endif
-        owner.pluginListWindow.reset(nullptr);
-    }
-
-private:
-    IconMenu& owner;
-};
-
-IconMenu::IconMenu() : 
-    INDEX_EDIT(1000000), 
-    INDEX_BYPASS(2000000), 
-    INDEX_DELETE(3000000), 
-    INDEX_MOVE_UP(4000000), 
-    INDEX_MOVE_DOWN(5000000)
-{
-    // Initialization
-    formatManager.addDefaultFormats();
-    #if JUCE_WINDOWS
-    x = y = 0;
-    #endif
-    
-    // Audio device setup
-    std::unique_ptr<XmlElement> savedAudioState(getAppProperties().getUserSettings()->getXmlValue("audioDeviceState"));
-    deviceManager.initialise(256, 256, savedAudioState.get(), true);
-    player.setProcessor(&graph);
-    deviceManager.addAudioCallback(&player);
-    
-    // Load all plugins
-    std::unique_ptr<XmlElement> savedPluginList(getAppProperties().getUserSettings()->getXmlValue("pluginList"));
-    if (savedPluginList != nullptr)
-        knownPluginList.recreateFromXml(*savedPluginList);
-    pluginSortMethod = KnownPluginList::sortByManufacturer;
-    knownPluginList.addChangeListener(this);
-    
-    // Load active plugins
-    std::unique_ptr<XmlElement> savedPluginListActive(getAppProperties().getUserSettings()->getXmlValue("pluginListActive"));
-    if (savedPluginListActive != nullptr)
-        activePluginList.recreateFromXml(*savedPluginListActive);
-    loadActivePlugins();
-    activePluginList.addChangeListener(this);
-    
-    // Setup system tray icon
-    setIcon();
-    setIconTooltip(JUCEApplication::getInstance()->getApplicationName());
-}
-
-IconMenu::~IconMenu()
-{
-    savePluginStates();
-}
-
-void IconMenu::setIcon()
-{
-    // Set menu icon
-    #if JUCE_MAC
-        if (exec("defaults read -g AppleInterfaceStyle").compare("Dark") == 1)
-            setIconImage(ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize),
-                         ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize));
-        else
-            setIconImage(ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize),
-                         ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize));
-    #else
-        String defaultColor;
-        #if JUCE_WINDOWS
-            defaultColor = "white";
-        #elif JUCE_LINUX
-            defaultColor = "black";
-        #endif
-        if (!getAppProperties().getUserSettings()->containsKey("icon"))
-            getAppProperties().getUserSettings()->setValue("icon", defaultColor);
-        String color = getAppProperties().getUserSettings()->getValue("icon");
-        Image icon;
-        if (color.equalsIgnoreCase("white"))
-            icon = ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize);
-        else if (color.equalsIgnoreCase("black"))
-            icon = ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize);
-        setIconImage(icon, icon);
-    #endif
-}
-
-void IconMenu::loadActivePlugins()
-{
-    const AudioProcessorGraph::NodeID INPUT(1000000);
-    const AudioProcessorGraph::NodeID OUTPUT(1000001);
-    const int CHANNEL_ONE = 0;
-    const int CHANNEL_TWO = 1;
-    
-    PluginWindow::closeAllCurrentlyOpenWindows();
-    graph.clear();
-    
-    // Create graph processors with std::unique_ptr
-    auto inputProcessor = std::make_unique<AudioProcessorGraph::AudioGraphIOProcessor>(
-        AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode);
-    auto outputProcessor = std::make_unique<AudioProcessorGraph::AudioGraphIOProcessor>(
-        AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode);
-        
-    // Add nodes to graph with proper ownership transfer
-    inputNode = graph.addNode(std::move(inputProcessor), INPUT);
-    outputNode = graph.addNode(std::move(outputProcessor), OUTPUT);
-    
-    // If no active plugins, connect input directly to output
-    if (activePluginList.getNumTypes() == 0)
-    {
-        // Use updated connection format
-        graph.addConnection({{INPUT, CHANNEL_ONE}, {OUTPUT, CHANNEL_ONE}});
-        graph.addConnection({{INPUT, CHANNEL_TWO}, {OUTPUT, CHANNEL_TWO}});
-        return;
-    }
-    
-    int pluginTime = 0;
-    AudioProcessorGraph::NodeID lastId;
-    bool hasInputConnected = false;
-    
-    // Load plugins in order of time added
-    for (int i = 1; i <= activePluginList.getNumTypes(); i++)
-    {
-        PluginDescription plugin = getNextPluginOlderThanTime(pluginTime);
-        String errorMessage;
-        
-        // Create plugin instance with std::unique_ptr
-        std::unique_ptr<AudioPluginInstance> instance = formatManager.createPluginInstance(
-            plugin, graph.getSampleRate(), graph.getBlockSize(), errorMessage);
-        
-        if (instance == nullptr) {
-            // Handle the error appropriately
-            continue;
-        }
-        
-        // Restore plugin state
-        String pluginUid = getKey("state", plugin);
-        String savedPluginState = getAppProperties().getUserSettings()->getValue(pluginUid);
-        MemoryBlock savedPluginBinary;
-        savedPluginBinary.fromBase64Encoding(savedPluginState);
-        if (savedPluginBinary.getSize() > 0)
-            instance->setStateInformation(savedPluginBinary.getData(), savedPluginBinary.getSize());
-            
-        AudioProcessorGraph::NodeID nodeId(i);
-        auto node = graph.addNode(std::move(instance), nodeId);
-        
-        // Check if plugin is bypassed
-        String key = getKey("bypass", plugin);
-        bool bypass = getAppProperties().getUserSettings()->getBoolValue(key, false);
-        
-        // Handle connections
-        if (!hasInputConnected && !bypass)
-        {
-            // First active plugin gets connected to input
-            graph.addConnection({{INPUT, CHANNEL_ONE}, {nodeId, CHANNEL_ONE}});
-            graph.addConnection({{INPUT, CHANNEL_TWO}, {nodeId, CHANNEL_TWO}});
-            hasInputConnected = true;
-        }
-        else if (!bypass && lastId != AudioProcessorGraph::NodeID())
-        {
-            // Connect previous plugin to current
-            graph.addConnection({{lastId, CHANNEL_ONE}, {nodeId, CHANNEL_ONE}});
-            graph.addConnection({{lastId, CHANNEL_TWO}, {nodeId, CHANNEL_TWO}});
-        }
-        
-        if (!bypass)
-            lastId = nodeId;
-    }
-    
-    if (lastId != AudioProcessorGraph::NodeID())
-    {
-        // Last active plugin to output
-        graph.addConnection({{lastId, CHANNEL_ONE}, {OUTPUT, CHANNEL_ONE}});
-        graph.addConnection({{lastId, CHANNEL_TWO}, {OUTPUT, CHANNEL_TWO}});
-    }
-    else
-    {
-        // No active plugins (all bypassed), connect input to output
-        graph.addConnection({{INPUT, CHANNEL_ONE}, {OUTPUT, CHANNEL_ONE}});
-        graph.addConnection({{INPUT, CHANNEL_TWO}, {OUTPUT, CHANNEL_TWO}});
-    }
-}
-
-PluginDescription IconMenu::getNextPluginOlderThanTime(int &time)
-{
-    int timeStatic = time;
-    PluginDescription closest;
-    int diff = INT_MAX;
-    
-    for (int i = 0; i < activePluginList.getNumTypes(); i++)
-    {
-        const auto& plugin = activePluginList.getTypes().getReference(i);
-        String key = getKey("order", plugin);
-        String pluginTimeString = getAppProperties().getUserSettings()->getValue(key);
-        int pluginTime = static_cast<int>(pluginTimeString.getIntValue());
-        
-        if (pluginTime > timeStatic && abs(timeStatic - pluginTime) < diff)
-        {
-            diff = abs(timeStatic - pluginTime);
-            closest = plugin;
-            time = pluginTime;
-        }
-    }
-    return closest;
-}
-
-void IconMenu::changeListenerCallback(ChangeBroadcaster* changed)
-{
-    if (changed == &knownPluginList)
-    {
-        std::unique_ptr<XmlElement> savedPluginList(knownPluginList.createXml());
-        if (savedPluginList != nullptr)
-        {
-            getAppProperties().getUserSettings()->setValue("pluginList", savedPluginList.get());
-            getAppProperties().saveIfNeeded();
-        }
-    }
-    else if (changed == &activePluginList)
-    {
-        std::unique_ptr<XmlElement> savedPluginList(activePluginList.createXml());
-        if (savedPluginList != nullptr)
-        {
-            getAppProperties().getUserSettings()->setValue("pluginListActive", savedPluginList.get());
-            getAppProperties().saveIfNeeded();
-        }
-    }
-}
-
-#if JUCE_MAC
-std::string IconMenu::exec(const char* cmd)
-{
-    std::shared_ptr<FILE> pipe(popen(cmd, "r"), pclose);
-    if (!pipe) return "ERROR";
-    
-    char buffer[128];
-    std::string result = "";
-    
-    while (!feof(pipe.get()))
-    {
-        if (fgets(buffer, 128, pipe.get()) != NULL)
-            result += buffer;
-    }
-    
-    return result;
-}
-#endif
-
-void IconMenu::timerCallback()
-{
-    stopTimer();
-    menu.clear();
-    menu.addSectionHeader(JUCEApplication::getInstance()->getApplicationName());
-    
-    if (menuIconLeftClicked) {
-        menu.addItem(1, "Preferences");
-        menu.addItem(2, "Edit Plugins");
-        menu.addSeparator();
-        menu.addSectionHeader("Active Plugins");
-        
-        // Add active plugins to menu
-        std::vector<PluginDescription> timeSorted = getTimeSortedList();
-        
-        for (int i = 0; i < timeSorted.size(); i++)
-        {
-            PopupMenu options;
-            options.addItem(INDEX_EDIT + i, "Edit");
-            
-            String key = getKey("bypass", timeSorted[i]);
-            bool bypass = getAppProperties().getUserSettings()->getBoolValue(key);
-            options.addItem(INDEX_BYPASS + i, "Bypass", true, bypass);
-            
-            options.addSeparator();
-            options.addItem(INDEX_MOVE_UP + i, "Move Up", i > 0);
-            options.addItem(INDEX_MOVE_DOWN + i, "Move Down", i < timeSorted.size() - 1);
-            
-            options.addSeparator();
-            options.addItem(INDEX_DELETE + i, "Delete");
-            
-            menu.addSubMenu(timeSorted[i].name, options);
-        }
-        
-        menu.addSeparator();
-        menu.addSectionHeader("Available Plugins");
-        
-        // Update KnownPluginList usage - use modern alternative
-        const auto& pluginTypes = knownPluginList.getTypes();
-        for (int i = 0; i < pluginTypes.size(); ++i) // Using int is acceptable if num types is within int range, JUCE often uses int for sizes.
-        {
-            const auto& p = pluginTypes.getUnchecked(i); // Use modern access
-            menu.addItem(3000 + i, p.name + " - " + p.pluginFormatName);
-        }
-    }
-    else {
-        menu.addItem(1, "Quit");
-        menu.addSeparator();
-        menu.addItem(2, "Delete Plugin States");
-        #if !JUCE_MAC
-            menu.addItem(3, "Invert Icon Color");
-        #endif
-    }
-    
-    #if JUCE_MAC || JUCE_LINUX
-    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(this), 
-                       ModalCallbackFunction::forComponent(menuInvocationCallback, this));
-    #else
-    if (x == 0 || y == 0)
-    {
-        POINT iconLocation;
-        iconLocation.x = 0;
-        iconLocation.y = 0;
-        GetCursorPos(&iconLocation);
-        x = iconLocation.x;
-        y = iconLocation.y;
-    }
-    juce::Rectangle<int> rect(x, y, 1, 1);
-    menu.showMenuAsync(PopupMenu::Options().withTargetScreenArea(rect), 
-                       ModalCallbackFunction::forComponent(menuInvocationCallback, this));
-    #endif
-}
-
-void IconMenu::mouseDown(const MouseEvent& e)
-{
-    #if JUCE_MAC
-        Process::setDockIconVisible(true);
-    #endif
-    Process::makeForegroundProcess();
-    menuIconLeftClicked = e.mods.isLeftButtonDown();
-    startTimer(50);
-}
-
-void IconMenu::menuInvocationCallback(int id, IconMenu* im)
-{
-    // Right click menu
-    if (!im->menuIconLeftClicked)
-    {
-        if (id == 1)
-        {
-            im->savePluginStates();
-            return JUCEApplication::getInstance()->quit();
-        }
-        if (id == 2)
-        {
-            im->deletePluginStates();
-            return im->loadActivePlugins();
-        }
-        if (id == 3)
-        {
-            String color = getAppProperties().getUserSettings()->getValue("icon");
-            getAppProperties().getUserSettings()->setValue("icon", color.equalsIgnoreCase("black") ? "white" : "black");
-            return im->setIcon();
-        }
-    }
-    
-    #if JUCE_MAC
-    // Hide icon if clicked elsewhere without active windows
-    if (id == 0 && !PluginWindow::containsActiveWindows())
-        Process::setDockIconVisible(false);
-    #endif
-    
-    // Audio settings
-    if (id == 1)
-        im->showAudioSettings();
-    
-    // Plugin editor
-    if (id == 2)
-        im->reloadPlugins();
-    
-    // Other menu options
-    if (id > 2)
-    {
-        // Delete plugin
-        if (id >= im->INDEX_DELETE && id < im->INDEX_DELETE + 1000000)
-        {
-            im->deletePluginStates();
-
-            int index = id - im->INDEX_DELETE;
-            std::vector<PluginDescription> timeSorted = im->getTimeSortedList();
-            String key = getKey("order", timeSorted[index]);
-            int unsortedIndex = 0;
-            
-            for (int i = 0; i < im->activePluginList.getNumTypes(); i++)
-            {
-                const auto& current = im->activePluginList.getTypes().getReference(i);
-                if (key.equalsIgnoreCase(getKey("order", current)))
-                {
-                    unsortedIndex = i;
-                    break;
-                }
-            }
-
-            // Remove plugin data
-            getAppProperties().getUserSettings()->removeValue(key);
-            getAppProperties().getUserSettings()->removeValue(getKey("bypass", timeSorted[index]));
-            getAppProperties().getUserSettings()->removeValue(getKey("state", timeSorted[index]));
-            getAppProperties().saveIfNeeded();
-            
-            // Remove plugin from list
-            const auto& pd = im->activePluginList.getTypes().getReference(unsortedIndex);
-            im->activePluginList.removeType(pd);
-
-            im->savePluginStates();
-            im->loadActivePlugins();
-        }
-        // Add plugin (using a revised implementation)
-        else if (id >= 3000 && id < 3000 + im->knownPluginList.getNumTypes())
-        {
-            int index = id - 3000;
-            if (index >= 0 && index < im->knownPluginList.getNumTypes())
-            {
-                const auto& plugin = im->knownPluginList.getTypes().getReference(index);
-                String key = getKey("order", plugin);
-                int t = static_cast<int>(time(nullptr));
-                getAppProperties().getUserSettings()->setValue(key, t);
-                getAppProperties().saveIfNeeded();
-                
-                im->activePluginList.addType(plugin);
-                im->savePluginStates();
-                im->loadActivePlugins();
-            }
-        }
-        // Bypass plugin
-        else if (id >= im->INDEX_BYPASS && id < im->INDEX_BYPASS + 1000000)
-        {
-            int index = id - im->INDEX_BYPASS;
-            std::vector<PluginDescription> timeSorted = im->getTimeSortedList();
-            String key = getKey("bypass", timeSorted[index]);
-
-            // Toggle bypass flag
-            bool bypassed = getAppProperties().getUserSettings()->getBoolValue(key);
-            getAppProperties().getUserSettings()->setValue(key, !bypassed);
-            getAppProperties().saveIfNeeded();
-
-            im->savePluginStates();
-            im->loadActivePlugins();
-        }
-        // Show active plugin GUI
-        else if (id >= im->INDEX_EDIT && id < im->INDEX_EDIT + 1000000)
-        {
-            // Updated NodeID usage
-            AudioProcessorGraph::NodeID nodeId(id - im->INDEX_EDIT + 1);
-            if (const AudioProcessorGraph::Node::Ptr f = im->graph.getNodeForId(nodeId))
-                if (auto w = PluginWindow::getWindowFor(f, PluginWindow::Normal))
-                    w->toFront(true);
-        }
-        // Move plugin up the list
-        else if (id >= im->INDEX_MOVE_UP && id < im->INDEX_MOVE_UP + 1000000)
-        {
-            im->savePluginStates();
-            std::vector<PluginDescription> timeSorted = im->getTimeSortedList();
-            PluginDescription toMove = timeSorted[id - im->INDEX_MOVE_UP];
-            
-            for (int i = 0; i < timeSorted.size(); i++)
-            {
-                bool move = getKey("move", toMove).equalsIgnoreCase(getKey("move", timeSorted[i]));
-                getAppProperties().getUserSettings()->setValue(getKey("order", timeSorted[i]), move ? i : i+1);
-                if (move && i > 0)
-                    getAppProperties().getUserSettings()->setValue(getKey("order", timeSorted[i-1]), i+1);
-            }
-            getAppProperties().saveIfNeeded();
-            im->loadActivePlugins();
-        }
-        // Move plugin down the list
-        else if (id >= im->INDEX_MOVE_DOWN && id < im->INDEX_MOVE_DOWN + 1000000)
-        {
-            im->savePluginStates();
-            std::vector<PluginDescription> timeSorted = im->getTimeSortedList();
-            PluginDescription toMove = timeSorted[id - im->INDEX_MOVE_DOWN];
-            
-            for (int i = 0; i < timeSorted.size(); i++)
-            {
-                bool move = getKey("move", toMove).equalsIgnoreCase(getKey("move", timeSorted[i]));
-                getAppProperties().getUserSettings()->setValue(getKey("order", timeSorted[i]), move ? i+2 : i+1);
-                if (move && i+1 < timeSorted.size())
-                {
-                    getAppProperties().getUserSettings()->setValue(getKey("order", timeSorted[i + 1]), i + 1);
-                    i++;
-                }
-            }
-            getAppProperties().saveIfNeeded();
-            im->loadActivePlugins();
-        }
-        
-        // Update menu
-        im->startTimer(50);
-    }
-}
-
-std::vector<PluginDescription> IconMenu::getTimeSortedList()
-{
-    int time = 0;
-    std::vector<PluginDescription> list;
-    list.reserve(activePluginList.getNumTypes()); // Pre-allocate for performance
-    
-    for (int i = 0; i < activePluginList.getNumTypes(); i++)
-        list.push_back(getNextPluginOlderThanTime(time));
-    
-    return list;
-}
-
-String IconMenu::getKey(String type, PluginDescription plugin)
-{
-    return "plugin-" + type.toLowerCase() + "-" + plugin.name + plugin.version + plugin.pluginFormatName;
-}
-
-void IconMenu::deletePluginStates()
-{
-    std::vector<PluginDescription> list = getTimeSortedList();
-    for (int i = 0; i < list.size(); i++)
-    {
-        String pluginUid = getKey("state", list[i]);
-        getAppProperties().getUserSettings()->removeValue(pluginUid);
-    }
-    getAppProperties().saveIfNeeded();
-}
-
-void IconMenu::savePluginStates()
-{
-    std::vector<PluginDescription> list = getTimeSortedList();
-    
-    for (int i = 0; i < list.size(); i++)
-    {
-        AudioProcessorGraph::NodeID nodeId(i + 1);
-        auto node = graph.getNodeForId(nodeId);
-        if (node == nullptr || node->getProcessor() == nullptr)
-            continue;
-            
-        AudioProcessor& processor = *node->getProcessor();
-        String pluginUid = getKey("state", list[i]);
-        MemoryBlock savedStateBinary;
-        processor.getStateInformation(savedStateBinary);
-        
-        if (savedStateBinary.getSize() > 0)
-            getAppProperties().getUserSettings()->setValue(pluginUid, savedStateBinary.toBase64Encoding());
-    }
-    getAppProperties().saveIfNeeded();
-}
-
-void IconMenu::showAudioSettings()
-{
-    AudioDeviceSelectorComponent audioSettingsComp(deviceManager, 0, 256, 0, 256, false, false, true, true);
-    audioSettingsComp.setSize(500, 450);
-    
-    DialogWindow::LaunchOptions o;
-    o.content.setNonOwned(&audioSettingsComp);
-    o.dialogTitle                   = "Audio Settings";
-    o.componentToCentreAround       = this;
-    o.dialogBackgroundColour        = Colour::fromRGB(236, 236, 236);
-    o.escapeKeyTriggersCloseButton  = true;
-    o.useNativeTitleBar             = true;
-    o.resizable                     = false;
-
-    o.launchAsync();
-        
-    std::unique_ptr<XmlElement> audioState(deviceManager.createStateXml());
-        
-    getAppProperties().getUserSettings()->setValue("audioDeviceState", audioState.get());
-    getAppProperties().saveIfNeeded();
-}
-
-void IconMenu::reloadPlugins()
-{
-    if (pluginListWindow == nullptr)
-        pluginListWindow = std::make_unique<PluginListWindow>(*this, formatManager);
-    else
-        pluginListWindow->toFront(true);
-}
-
-void IconMenu::removePluginsLackingInputOutput()
-{
-    std::vector<PluginDescription> pluginsToRemove;
-    const auto& pluginTypes = knownPluginList.getTypes();
-    for (int i = 0; i < pluginTypes.size(); ++i)
-    {
-        const auto& pluginRef = pluginTypes.getReference(i);
-        if (pluginRef.numInputChannels < 2 || pluginRef.numOutputChannels < 2)
-        pluginsToRemove.push_back(pluginRef);
-    }
-    
-    // Remove plugins that don't have enough channels
-    for (const auto& plugin : pluginsToRemove)
-        knownPluginList.removeType(plugin);
+//
+//  IconMenu.cpp
+//  SoftHost
+//
+//  Created by Rolando Islas on 12/26/15.
+//  Updated and optimized on 04/10/25.
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "IconMenu.hpp"
+#include "PluginWindow.hpp"
+#include "RealtimePolicy.hpp"
+#include "Tracer.hpp"
+#if JUCE_WINDOWS
+#include "Windows.h"
+#endif
+
+class IconMenu::PluginListWindow : public DocumentWindow
+{
+public:
+    PluginListWindow(IconMenu& owner_, AudioPluginFormatManager& pluginFormatManager)
+        : DocumentWindow("Available Plugins", Colours::white,
+            DocumentWindow::minimiseButton | DocumentWindow::closeButton),
+        owner(owner_)
+    {
+        const File deadMansPedalFile(getAppProperties().getUserSettings()
+            ->getFile().getSiblingFile("RecentlyCrashedPluginsList"));
+
+        setContentOwned(new PluginListComponent(pluginFormatManager,
+            owner.knownPluginList,
+            deadMansPedalFile,
+            getAppProperties().getUserSettings()), true);
+
+        setUsingNativeTitleBar(true);
+        setResizable(true, false);
+        setResizeLimits(300, 400, 800, 1500);
+        setTopLeftPosition(60, 60);
+
+        restoreWindowStateFromString(getAppProperties().getUserSettings()->getValue("listWindowPos"));
+        setVisible(true);
+    }
+
+    ~PluginListWindow() override
+    {
+        getAppProperties().getUserSettings()->setValue("listWindowPos", getWindowStateAsString());
+        clearContentComponent();
+    }
+
+    void closeButtonPressed() override
+    {
+        owner.removePluginsLackingInputOutput();
+        #if JUCE_MAC
+        Process::setDockIconVisible(false);
+        #endif
+        owner.pluginListWindow.reset(nullptr);
+    }
+
+private:
+    IconMenu& owner;
+};
+
+IconMenu::IconMenu() : 
+    INDEX_EDIT(1000000), 
+    INDEX_BYPASS(2000000), 
+    INDEX_DELETE(3000000), 
+    INDEX_MOVE_UP(4000000), 
+    INDEX_MOVE_DOWN(5000000),
+    INDEX_SCENE(6000000),
+    INDEX_SCENE_HOT(7000000),
+    INDEX_SCENE_DELETE(8000000),
+    INDEX_MIDI(9000000),
+    INDEX_MIDI_LEARN(10000000),
+    INDEX_MIDI_CLEAR(11000000),
+    INDEX_CHAIN(12000000),
+    INDEX_CHAIN_SHARE(13000000),
+    INDEX_CHAIN_DELETE(14000000),
+    INDEX_CHAIN_CHANNELS(15000000),
+    INDEX_CONTROLS(16000000),
+    INDEX_MODULATION(17000000)
+{
+    // Initialization
+    formatManager.addDefaultFormats();
+    #if JUCE_WINDOWS
+    x = y = 0;
+    #endif
+    
+    // Load all plugins
+    std::unique_ptr<XmlElement> savedPluginList(getAppProperties().getUserSettings()->getXmlValue("pluginList"));
+    if (savedPluginList != nullptr)
+        knownPluginList.recreateFromXml(*savedPluginList);
+    pluginSortMethod = KnownPluginList::sortByManufacturer;
+    knownPluginList.addChangeListener(this);
+    
+    // Scheduling policy first, the audio threads pick it up on their first callback
+    RealtimePolicy::configure(*getAppProperties().getUserSettings());
+
+    // Load the chains, the main one first since the others may play on its device
+    chains.add(new AudioChain(AudioChain::mainName, formatManager));
+    std::unique_ptr<XmlElement> savedChains(getAppProperties().getUserSettings()->getXmlValue("chains"));
+    if (savedChains != nullptr)
+        for (auto* chain : savedChains->getChildWithTagNameIterator("CHAIN"))
+            addChain(chain->getStringAttribute("name"));
+
+    // Scripts can drive the chains once they exist
+    const File socketFile = ControlServer::getSocketFile(*getAppProperties().getUserSettings());
+    if (socketFile != File())
+    {
+        controlServer = std::make_unique<ControlServer>(chains, socketFile);
+        if (!controlServer->start())
+            controlServer.reset();
+    }
+
+    lockMemoryWhenLoaded();
+    
+    // Setup system tray icon
+    setIcon();
+    setIconTooltip(JUCEApplication::getInstance()->getApplicationName());
+}
+
+IconMenu::~IconMenu()
+{
+    controlServer.reset();
+    savePluginStates();
+    meterWindow.reset();
+
+    // Chains sharing the main device have to let go of it first
+    while (chains.size() > 0)
+        chains.removeLast();
+}
+
+void IconMenu::setIcon()
+{
+    // Set menu icon
+    #if JUCE_MAC
+        if (exec("defaults read -g AppleInterfaceStyle").compare("Dark") == 1)
+            setIconImage(ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize),
+                         ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize));
+        else
+            setIconImage(ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize),
+                         ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize));
+    #else
+        String defaultColor;
+        #if JUCE_WINDOWS
+            defaultColor = "white";
+        #elif JUCE_LINUX
+            defaultColor = "black";
+        #endif
+        if (!getAppProperties().getUserSettings()->containsKey("icon"))
+            getAppProperties().getUserSettings()->setValue("icon", defaultColor);
+        String color = getAppProperties().getUserSettings()->getValue("icon");
+        Image icon;
+        if (color.equalsIgnoreCase("white"))
+            icon = ImageFileFormat::loadFrom(BinaryData::menu_icon_white_png, BinaryData::menu_icon_white_pngSize);
+        else if (color.equalsIgnoreCase("black"))
+            icon = ImageFileFormat::loadFrom(BinaryData::menu_icon_png, BinaryData::menu_icon_pngSize);
+        setIconImage(icon, icon);
+    #endif
+}
+
+void IconMenu::loadActivePlugins(bool recreateInstances)
+{
+    getEditedChain().loadActivePlugins(recreateInstances);
+}
+
+void IconMenu::changeListenerCallback(ChangeBroadcaster* changed)
+{
+    if (changed == &knownPluginList)
+    {
+        std::unique_ptr<XmlElement> savedPluginList(knownPluginList.createXml());
+        if (savedPluginList != nullptr)
+        {
+            getAppProperties().getUserSettings()->setValue("pluginList", savedPluginList.get());
+            saveAppProperties();
+        }
+    }
+}
+
+void IconMenu::switchToScene(const String& name)
+{
+    // Scenes named on the command line belong to the main chain
+    SceneSwitcher& scenes = chains.getFirst()->getScenes();
+    const int index = scenes.indexOf(name);
+    if (index >= 0)
+        scenes.switchTo(index);
+}
+
+void IconMenu::showNameDialog(const String& title, const String& message, std::function<void(const String&)> onCreate)
+{
+    nameWindow = std::make_unique<AlertWindow>(title, message, AlertWindow::NoIcon);
+    nameWindow->addTextEditor("name", String());
+    nameWindow->addButton("Create", 1, KeyPress(KeyPress::returnKey));
+    nameWindow->addButton("Cancel", 0, KeyPress(KeyPress::escapeKey));
+    nameWindow->enterModalState(true, ModalCallbackFunction::create([this, onCreate] (int result)
+    {
+        const String name = nameWindow->getTextEditorContents("name").trim();
+        nameWindow.reset();
+        if (result == 1 && name.isNotEmpty())
+            onCreate(name);
+    }));
+}
+
+void IconMenu::showNewSceneDialog()
+{
+    showNameDialog("New Scene", "The new scene starts as a copy of \"" + getScenes().getActiveScene().getName() + "\".",
+                   [this] (const String& name)
+    {
+        getScenes().addScene(name);
+        const int index = getScenes().indexOf(name);
+        if (index >= 0)
+            getScenes().switchTo(index);
+    });
+}
+
+void IconMenu::showNewChainDialog()
+{
+    showNameDialog("New Chain", "The new chain plays on outputs 3-4 of the main device. A chain named after a "
+                   "former -multi-instance process picks up its settings and device.", [this] (const String& name)
+    {
+        if (addChain(name))
+        {
+            editedChain = chains.size() - 1;
+            saveChainList();
+        }
+    });
+}
+
+bool IconMenu::addChain(const String& name)
+{
+    if (name.isEmpty() || name.equalsIgnoreCase(AudioChain::mainName))
+        return false;
+
+    for (auto* chain : chains)
+        if (chain->getName().equalsIgnoreCase(name))
+            return false;
+
+    const TraceScope trace("addChain");
+    chains.add(new AudioChain(name, formatManager, chains.getFirst()));
+    return true;
+}
+
+void IconMenu::removeChain(int index)
+{
+    // The main chain stays, and removed chains keep their settings file for a later comeback
+    if (index <= 0 || index >= chains.size())
+        return;
+
+    chains.getUnchecked(index)->savePluginStates();
+    if (meterWindow != nullptr && &meterWindow->getChain() == chains.getUnchecked(index))
+        meterWindow.reset();
+    chains.remove(index);
+
+    if (editedChain >= index)
+        editedChain = editedChain == index ? 0 : editedChain - 1;
+    saveChainList();
+}
+
+void IconMenu::saveChainList()
+{
+    XmlElement list("CHAINS");
+    for (auto* chain : chains)
+        if (!chain->isMain())
+            list.createNewChildElement("CHAIN")->setAttribute("name", chain->getName());
+
+    getAppProperties().getUserSettings()->setValue("chains", &list);
+    saveAppProperties();
+}
+
+#if JUCE_MAC
+std::string IconMenu::exec(const char* cmd)
+{
+    std::shared_ptr<FILE> pipe(popen(cmd, "r"), pclose);
+    if (!pipe) return "ERROR";
+    
+    char buffer[128];
+    std::string result = "";
+    
+    while (!feof(pipe.get()))
+    {
+        if (fgets(buffer, 128, pipe.get()) != NULL)
+            result += buffer;
+    }
+    
+    return result;
+}
+#endif
+
+void IconMenu::timerCallback()
+{
+    stopTimer();
+    menu.clear();
+    menu.addSectionHeader(JUCEApplication::getInstance()->getApplicationName());
+    
+    if (menuIconLeftClicked) {
+        menu.addItem(1, "Preferences");
+        menu.addItem(2, "Edit Plugins");
+        menu.addItem(16, "Meters");
+
+        // Recording options only change between recordings
+        const RecordingTap& recorder = getEditedChain().getRecorder();
+        const bool recording = recorder.isRecording();
+        PopupMenu record;
+        if (recording)
+            record.addItem(6, "Stop Recording (" + String(roundToInt(recorder.getSecondsRecorded())) + " s, "
+                              + String(recorder.getNumDropped()) + " dropped blocks)");
+        else
+            record.addItem(6, "Start Recording");
+        record.addSectionHeader("Source");
+        record.addItem(7, "Input", !recording, recorder.getSource() == RecordingTap::Input);
+        record.addItem(8, "Output", !recording, recorder.getSource() == RecordingTap::Output);
+        record.addItem(9, "Input and Output", !recording, recorder.getSource() == RecordingTap::InputAndOutput);
+        record.addSectionHeader("Format");
+        record.addItem(10, "WAV", !recording, !recorder.isUsingFlac());
+        record.addItem(11, "FLAC", !recording, recorder.isUsingFlac());
+        record.addSectionHeader("Pre-Roll");
+        record.addItem(12, "Off", !recording, recorder.getPreRollSeconds() == 0);
+        record.addItem(13, "10 Seconds", !recording, recorder.getPreRollSeconds() == 10);
+        record.addItem(14, "30 Seconds", !recording, recorder.getPreRollSeconds() == 30);
+        record.addItem(15, "60 Seconds", !recording, recorder.getPreRollSeconds() == 60);
+        menu.addSubMenu(recording ? "Record (Recording)" : "Record", record);
+
+        menu.addSeparator();
+        menu.addSectionHeader("Chains");
+
+        // Channel pairs are offered from the outputs the main device has open
+        int numMainOutputs = 0;
+        if (auto* device = chains.getFirst()->getDeviceManager().getCurrentAudioDevice())
+            numMainOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+
+        for (int i = 0; i < chains.size(); i++)
+        {
+            AudioChain* chain = chains.getUnchecked(i);
+            const bool edited = i == editedChain;
+
+            PopupMenu options;
+            options.addItem(INDEX_CHAIN + i, "Edit", !edited, edited);
+            if (!chain->isMain())
+            {
+                options.addSeparator();
+                options.addItem(INDEX_CHAIN_SHARE + i, "Share Main Device", true, chain->isSharingMainDevice());
+
+                PopupMenu pairs;
+                for (int pair = 0; pair + 1 < numMainOutputs; pair += 2)
+                    pairs.addItem(INDEX_CHAIN_CHANNELS + i * 1000 + pair, "Outputs " + String(pair + 1) + "-" + String(pair + 2),
+                                  true, chain->getChannelPair() == pair);
+                options.addSubMenu("Channels", pairs, chain->isSharingMainDevice());
+
+                options.addSeparator();
+                options.addItem(INDEX_CHAIN_DELETE + i, "Delete");
+            }
+
+            menu.addSubMenu(chain->getName(), options, true, nullptr, edited);
+        }
+        menu.addItem(5, "New Chain...");
+
+        SceneSwitcher& scenes = getScenes();
+        menu.addSeparator();
+        menu.addSectionHeader("Scenes");
+
+        for (int i = 0; i < scenes.getNumScenes(); i++)
+        {
+            const Scene* scene = scenes.getScene(i);
+            const bool active = i == scenes.getActiveIndex();
+
+            PopupMenu options;
+            options.addItem(INDEX_SCENE + i, "Switch To", !active, active);
+            options.addItem(INDEX_SCENE_HOT + i, "Keep Loaded", true, scene->isHot());
+            options.addSeparator();
+            options.addItem(INDEX_SCENE_DELETE + i, "Delete", scenes.canRemove(i));
+
+            menu.addSubMenu(scene->getName() + (scenes.isLoading(i) ? " (Loading)" : ""), options, true, nullptr, active);
+        }
+        menu.addItem(4, "New Scene...");
+
+        menu.addSeparator();
+        menu.addSectionHeader("Active Plugins");
+        
+        // Add active plugins to menu
+        std::vector<PluginDescription> timeSorted = getChain().getTimeSortedList();
+        
+        for (int i = 0; i < timeSorted.size(); i++)
+        {
+            PluginSlot* slot = getSlot(i);
+            PopupMenu options;
+            options.addItem(INDEX_EDIT + i, "Edit");
+            options.addItem(INDEX_CONTROLS + i, "Mix and Trim", slot != nullptr, slot != nullptr && !slot->hasDefaultControls());
+            options.addItem(INDEX_MODULATION + i, "Modulation", slot != nullptr, slot != nullptr && slot->getModulation().isActive());
+            
+            bool bypass = getChain().isBypassed(timeSorted[i]);
+            options.addItem(INDEX_BYPASS + i, "Bypass", true, bypass);
+
+            options.addSeparator();
+            options.addItem(INDEX_MIDI + i, "Receive MIDI", slot != nullptr,
+                            slot != nullptr && getChain().receivesMidi(timeSorted[i], slot));
+            options.addItem(INDEX_MIDI_LEARN + i, "MIDI Learn", slot != nullptr, slot != nullptr && slot->isLearning());
+            options.addItem(INDEX_MIDI_CLEAR + i, "Clear MIDI Learn", slot != nullptr && slot->hasMidiMappings());
+            
+            options.addSeparator();
+            options.addItem(INDEX_MOVE_UP + i, "Move Up", i > 0);
+            options.addItem(INDEX_MOVE_DOWN + i, "Move Down", i < timeSorted.size() - 1);
+            
+            options.addSeparator();
+            options.addItem(INDEX_DELETE + i, "Delete");
+
+            // What creating this instance cost, see LoadCost. Headers are not selectable and need no id
+            if (slot != nullptr && slot->getLoadCost().measured)
+            {
+                options.addSeparator();
+                options.addSectionHeader(slot->getLoadCost().getMemorySummary());
+                options.addSectionHeader(slot->getLoadCost().getTimeSummary());
+            }
+            
+            menu.addSubMenu(timeSorted[i].name, options);
+        }
+        
+        menu.addSeparator();
+        menu.addSectionHeader("Available Plugins");
+        
+        // Update KnownPluginList usage - use modern alternative
+        const auto& pluginTypes = knownPluginList.getTypes();
+        for (int i = 0; i < pluginTypes.size(); ++i) // Using int is acceptable if num types is within int range, JUCE often uses int for sizes.
+        {
+            const auto& p = pluginTypes.getUnchecked(i); // Use modern access
+            menu.addItem(3000 + i, p.name + " - " + p.pluginFormatName);
+        }
+    }
+    else {
+        menu.addItem(1, "Quit");
+        menu.addSeparator();
+        menu.addItem(2, "Delete Plugin States");
+        #if !JUCE_MAC
+            menu.addItem(3, "Invert Icon Color");
+        #endif
+        menu.addItem(5, "Unload Minimised Editors", true,
+                     getAppProperties().getUserSettings()->getBoolValue(getUnloadEditorsProp(), false));
+        menu.addItem(6, "Auto-Tune Buffer Size", !getEditedChain().isSharingMainDevice(),
+                     getEditedChain().getBufferSizeTuner().isEnabled());
+        menu.addSeparator();
+        menu.addItem(4, Tracer::isRecording() ? "Stop Tracing and Save" : "Start Tracing");
+        menu.addItem(7, "Export Plugin Load Report");
+    }
+    
+    #if JUCE_MAC || JUCE_LINUX
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(this), 
+                       ModalCallbackFunction::forComponent(menuInvocationCallback, this));
+    #else
+    if (x == 0 || y == 0)
+    {
+        POINT iconLocation;
+        iconLocation.x = 0;
+        iconLocation.y = 0;
+        GetCursorPos(&iconLocation);
+        x = iconLocation.x;
+        y = iconLocation.y;
+    }
+    juce::Rectangle<int> rect(x, y, 1, 1);
+    menu.showMenuAsync(PopupMenu::Options().withTargetScreenArea(rect), 
+                       ModalCallbackFunction::forComponent(menuInvocationCallback, this));
+    #endif
+}
+
+void IconMenu::mouseDown(const MouseEvent& e)
+{
+    #if JUCE_MAC
+        Process::setDockIconVisible(true);
+    #endif
+    Process::makeForegroundProcess();
+    menuIconLeftClicked = e.mods.isLeftButtonDown();
+    startTimer(50);
+}
+
+void IconMenu::menuInvocationCallback(int id, IconMenu* im)
+{
+    // Right click menu
+    if (!im->menuIconLeftClicked)
+    {
+        if (id == 1)
+        {
+            im->savePluginStates();
+            return JUCEApplication::getInstance()->quit();
+        }
+        if (id == 2)
+        {
+            im->deletePluginStates();
+            return im->loadActivePlugins(true);
+        }
+        if (id == 3)
+        {
+            String color = getAppProperties().getUserSettings()->getValue("icon");
+            getAppProperties().getUserSettings()->setValue("icon", color.equalsIgnoreCase("black") ? "white" : "black");
+            return im->setIcon();
+        }
+        if (id == 4)
+            return im->toggleTracing();
+        if (id == 7)
+            return im->exportLoadReport();
+        if (id == 5)
+        {
+            bool unload = getAppProperties().getUserSettings()->getBoolValue(getUnloadEditorsProp(), false);
+            getAppProperties().getUserSettings()->setValue(getUnloadEditorsProp(), !unload);
+            return saveAppProperties();
+        }
+        if (id == 6)
+        {
+            BufferSizeTuner& tuner = im->getEditedChain().getBufferSizeTuner();
+            tuner.setEnabled(!tuner.isEnabled());
+            return im->getEditedChain().saveSettings();
+        }
+    }
+    
+    #if JUCE_MAC
+    // Hide icon if clicked elsewhere without active windows
+    if (id == 0 && !PluginWindow::containsActiveWindows())
+        Process::setDockIconVisible(false);
+    #endif
+    
+    // Audio settings
+    if (id == 1)
+        im->showAudioSettings();
+    
+    // Plugin editor
+    if (id == 2)
+        im->reloadPlugins();
+
+    // Copy the active scene under a new name
+    if (id == 4)
+        return im->showNewSceneDialog();
+
+    // Add a chain under a new name
+    if (id == 5)
+        return im->showNewChainDialog();
+
+    // Meters of the edited chain
+    if (id == 16)
+        return im->showMeters();
+
+    // Recording of the edited chain
+    if (id == 6)
+        return im->toggleRecording();
+    if (id >= 7 && id <= 15)
+    {
+        RecordingTap& recorder = im->getEditedChain().getRecorder();
+        if (id <= 9)
+            recorder.setSource(id == 7 ? RecordingTap::Input : id == 8 ? RecordingTap::Output : RecordingTap::InputAndOutput);
+        else if (id <= 11)
+            recorder.setUsingFlac(id == 11);
+        else
+            recorder.setPreRollSeconds(id == 12 ? 0 : id == 13 ? 10 : id == 14 ? 30 : 60);
+        return im->getEditedChain().saveSettings();
+    }
+    
+    // Other menu options
+    if (id > 2)
+    {
+        // Edit another chain
+        if (id >= im->INDEX_CHAIN && id < im->INDEX_CHAIN + 1000000)
+        {
+            im->editedChain = jlimit(0, im->chains.size() - 1, id - im->INDEX_CHAIN);
+        }
+        // Move a chain between the main device and one of its own
+        else if (id >= im->INDEX_CHAIN_SHARE && id < im->INDEX_CHAIN_SHARE + 1000000)
+        {
+            if (AudioChain* chain = im->chains[id - im->INDEX_CHAIN_SHARE])
+                chain->setSharingMainDevice(!chain->isSharingMainDevice());
+        }
+        // Pick the main device outputs of a sharing chain
+        else if (id >= im->INDEX_CHAIN_CHANNELS && id < im->INDEX_CHAIN_CHANNELS + 1000000)
+        {
+            if (AudioChain* chain = im->chains[(id - im->INDEX_CHAIN_CHANNELS) / 1000])
+                chain->setChannelPair((id - im->INDEX_CHAIN_CHANNELS) % 1000);
+        }
+        // Delete chain
+        else if (id >= im->INDEX_CHAIN_DELETE && id < im->INDEX_CHAIN_DELETE + 1000000)
+        {
+            im->removeChain(id - im->INDEX_CHAIN_DELETE);
+        }
+        // Switch scene
+        else if (id >= im->INDEX_SCENE && id < im->INDEX_SCENE + 1000000)
+        {
+            im->savePluginStates();
+            im->getScenes().switchTo(id - im->INDEX_SCENE);
+        }
+        // Keep a scene loaded
+        else if (id >= im->INDEX_SCENE_HOT && id < im->INDEX_SCENE_HOT + 1000000)
+        {
+            int index = id - im->INDEX_SCENE_HOT;
+            if (const Scene* scene = im->getScenes().getScene(index))
+                im->getScenes().setHot(index, !scene->isHot());
+        }
+        // Delete scene
+        else if (id >= im->INDEX_SCENE_DELETE && id < im->INDEX_SCENE_DELETE + 1000000)
+        {
+            im->getScenes().removeScene(id - im->INDEX_SCENE_DELETE);
+        }
+        // Delete plugin
+        else if (id >= im->INDEX_DELETE && id < im->INDEX_DELETE + 1000000)
+        {
+            im->deletePluginStates();
+            im->getChain().removePlugin(id - im->INDEX_DELETE);
+            im->getEditedChain().saveSettings();
+
+            im->savePluginStates();
+            im->loadActivePlugins();
+        }
+        // Add plugin (using a revised implementation)
+        else if (id >= 3000 && id < 3000 + im->knownPluginList.getNumTypes())
+        {
+            int index = id - 3000;
+            if (index >= 0 && index < im->knownPluginList.getNumTypes())
+            {
+                im->getChain().addPlugin(im->knownPluginList.getTypes().getReference(index));
+                im->getEditedChain().saveSettings();
+
+                im->savePluginStates();
+                im->loadActivePlugins();
+            }
+        }
+        // Route MIDI input to the plugin
+        else if (id >= im->INDEX_MIDI && id < im->INDEX_MIDI + 1000000)
+        {
+            int index = id - im->INDEX_MIDI;
+            std::vector<PluginDescription> timeSorted = im->getChain().getTimeSortedList();
+            if (PluginSlot* slot = im->getSlot(index))
+            {
+                im->getChain().setReceivesMidi(index, !im->getChain().receivesMidi(timeSorted[index], slot));
+                im->getEditedChain().saveSettings();
+                im->loadActivePlugins();
+            }
+        }
+        // Arm MIDI learn and show the editor, the next touched control takes the next controller moved
+        else if (id >= im->INDEX_MIDI_LEARN && id < im->INDEX_MIDI_LEARN + 1000000)
+        {
+            int index = id - im->INDEX_MIDI_LEARN;
+            std::vector<PluginDescription> timeSorted = im->getChain().getTimeSortedList();
+            if (PluginSlot* slot = im->getSlot(index))
+            {
+                slot->setLearning(!slot->isLearning());
+                if (slot->isLearning())
+                {
+                    if (!im->getChain().receivesMidi(timeSorted[index], slot))
+                    {
+                        im->getChain().setReceivesMidi(index, true);
+                        im->getEditedChain().saveSettings();
+                        im->loadActivePlugins();
+                    }
+                    if (auto* w = PluginWindow::getWindowFor(PluginChain::getNodeFor(im->getGraph(), timeSorted[index]),
+                                                             PluginWindow::Normal))
+                        w->toFront(true);
+                }
+            }
+        }
+        // Forget learned controllers
+        else if (id >= im->INDEX_MIDI_CLEAR && id < im->INDEX_MIDI_CLEAR + 1000000)
+        {
+            if (PluginSlot* slot = im->getSlot(id - im->INDEX_MIDI_CLEAR))
+            {
+                slot->setMidiMappings(String());
+                im->savePluginStates();
+            }
+        }
+        // Bypass plugin
+        else if (id >= im->INDEX_BYPASS && id < im->INDEX_BYPASS + 1000000)
+        {
+            im->getChain().toggleBypass(id - im->INDEX_BYPASS);
+            im->getEditedChain().saveSettings();
+
+            im->savePluginStates();
+            im->loadActivePlugins();
+        }
+        // Show active plugin GUI
+        else if (id >= im->INDEX_EDIT && id < im->INDEX_EDIT + 1000000)
+        {
+            std::vector<PluginDescription> timeSorted = im->getChain().getTimeSortedList();
+            if (const AudioProcessorGraph::Node::Ptr f = PluginChain::getNodeFor(im->getGraph(), timeSorted[id - im->INDEX_EDIT]))
+                if (auto* w = PluginWindow::getWindowFor(f, PluginWindow::Normal))
+                    w->toFront(true);
+        }
+        // Show the host's trims and mix for the plugin
+        else if (id >= im->INDEX_CONTROLS && id < im->INDEX_CONTROLS + 1000000)
+        {
+            std::vector<PluginDescription> timeSorted = im->getChain().getTimeSortedList();
+            if (const AudioProcessorGraph::Node::Ptr f = PluginChain::getNodeFor(im->getGraph(), timeSorted[id - im->INDEX_CONTROLS]))
+                if (auto* w = PluginWindow::getWindowFor(f, PluginWindow::SlotControls))
+                    w->toFront(true);
+        }
+        // Show the host's modulators for the plugin
+        else if (id >= im->INDEX_MODULATION && id < im->INDEX_MODULATION + 1000000)
+        {
+            std::vector<PluginDescription> timeSorted = im->getChain().getTimeSortedList();
+            if (const AudioProcessorGraph::Node::Ptr f = PluginChain::getNodeFor(im->getGraph(), timeSorted[id - im->INDEX_MODULATION]))
+                if (auto* w = PluginWindow::getWindowFor(f, PluginWindow::Modulation))
+                    w->toFront(true);
+        }
+        // Move plugin up the list
+        else if (id >= im->INDEX_MOVE_UP && id < im->INDEX_MOVE_UP + 1000000)
+        {
+            im->savePluginStates();
+            im->getChain().moveUp(id - im->INDEX_MOVE_UP);
+            im->getEditedChain().saveSettings();
+            im->loadActivePlugins();
+        }
+        // Move plugin down the list
+        else if (id >= im->INDEX_MOVE_DOWN && id < im->INDEX_MOVE_DOWN + 1000000)
+        {
+            im->savePluginStates();
+            im->getChain().moveDown(id - im->INDEX_MOVE_DOWN);
+            im->getEditedChain().saveSettings();
+            im->loadActivePlugins();
+        }
+        
+        // Update menu
+        im->startTimer(50);
+    }
+}
+
+void IconMenu::deletePluginStates()
+{
+    getChain().deleteStates();
+}
+
+void IconMenu::savePluginStates()
+{
+    for (auto* chain : chains)
+        chain->savePluginStates();
+}
+
+void IconMenu::showAudioSettings()
+{
+    // The dialog outlives this call, so it owns the selector. Changes are saved from changeListenerCallback()
+    AudioChain& chain = getEditedChain();
+    auto* audioSettingsComp = new AudioDeviceSelectorComponent(chain.getDeviceManager(), 0, 256, 0, 256, true, false, true, true);
+    audioSettingsComp->setSize(500, 450);
+    
+    DialogWindow::LaunchOptions o;
+    o.content.setOwned(audioSettingsComp);
+    o.dialogTitle                   = chain.isMain() || chain.isSharingMainDevice() ? String("Audio Settings")
+                                                                                     : "Audio Settings - " + chain.getName();
+    o.componentToCentreAround       = this;
+    o.dialogBackgroundColour        = Colour::fromRGB(236, 236, 236);
+    o.escapeKeyTriggersCloseButton  = true;
+    o.useNativeTitleBar             = true;
+    o.resizable                     = false;
+
+    o.launchAsync();
+}
+
+void IconMenu::lockMemoryWhenLoaded()
+{
+    Component::SafePointer<IconMenu> safeThis(this);
+
+    // Hot scenes load in the background, their plugins have to be in memory before it is locked
+    for (auto* chain : chains)
+    {
+        if (chain->getScenes().hasPendingLoads())
+        {
+            Timer::callAfterDelay(100, [safeThis]
+            {
+                if (safeThis != nullptr)
+                    safeThis->lockMemoryWhenLoaded();
+            });
+            return;
+        }
+    }
+
+    // Report what could not be applied once the devices had time to call back
+    RealtimePolicy::lockMemory();
+    Timer::callAfterDelay(3000, [safeThis]
+    {
+        if (safeThis == nullptr)
+            return;
+
+        const StringArray problems = RealtimePolicy::takeProblems();
+        for (const auto& problem : problems)
+            Logger::writeToLog("Realtime: " + problem);
+        if (!problems.isEmpty())
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Realtime Settings", problems.joinIntoString("\n"));
+    });
+}
+
+void IconMenu::toggleTracing()
+{
+    if (!Tracer::isRecording())
+        return Tracer::start();
+
+    Tracer::stop();
+    File traces = getAppProperties().getUserSettings()->getFile().getSiblingFile("Traces");
+    traces.createDirectory();
+    File trace = traces.getNonexistentChildFile("SoftHost-" + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".json");
+
+    if (Tracer::writeChromeTrace(trace))
+        trace.revealToUser();
+    else
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Tracing", "Unable to write " + trace.getFullPathName());
+}
+
+void IconMenu::exportLoadReport()
+{
+    // Every chain's active scene, one entry per plugin in chain order
+    Array<var> chainReports;
+    for (auto* chain : chains)
+    {
+        Array<var> plugins;
+        for (const auto& plugin : chain->getChain().getTimeSortedList())
+        {
+            DynamicObject::Ptr entry = new DynamicObject();
+            entry->setProperty("name", plugin.name);
+            entry->setProperty("format", plugin.pluginFormatName);
+            entry->setProperty("bypassed", chain->getChain().isBypassed(plugin));
+
+            auto node = PluginChain::getNodeFor(chain->getGraph(), plugin);
+            auto* slot = node != nullptr ? dynamic_cast<PluginSlot*>(node->getProcessor()) : nullptr;
+            entry->setProperty("load", slot != nullptr && slot->getLoadCost().measured ? slot->getLoadCost().toVar() : var());
+            plugins.add(entry.get());
+        }
+
+        DynamicObject::Ptr chainReport = new DynamicObject();
+        chainReport->setProperty("chain", chain->getName());
+        chainReport->setProperty("scene", chain->getScenes().getActiveScene().getName());
+        chainReport->setProperty("plugins", plugins);
+        chainReports.add(chainReport.get());
+    }
+
+    const LoadCost::MemoryUsage usage = LoadCost::getMemoryUsage();
+    DynamicObject::Ptr report = new DynamicObject();
+    report->setProperty("created", Time::getCurrentTime().toISO8601(true));
+    report->setProperty("residentBytes", usage.resident >= 0 ? var(usage.resident) : var());
+    report->setProperty("proportionalBytes", usage.proportional >= 0 ? var(usage.proportional) : var());
+    report->setProperty("chains", chainReports);
+
+    File reports = getAppProperties().getUserSettings()->getFile().getSiblingFile("Reports");
+    reports.createDirectory();
+    File file = reports.getNonexistentChildFile("Load-" + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".json");
+
+    if (file.replaceWithText(JSON::toString(var(report.get()))))
+        file.revealToUser();
+    else
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Plugin Load Report", "Unable to write " + file.getFullPathName());
+}
+
+void IconMenu::toggleRecording()
+{
+    AudioChain& chain = getEditedChain();
+    RecordingTap& recorder = chain.getRecorder();
+
+    if (!recorder.isRecording())
+    {
+        File recordings = getAppProperties().getUserSettings()->getFile().getSiblingFile("Recordings");
+        recordings.createDirectory();
+        String name = "SoftHost-" + (chain.isMain() ? String() : chain.getName() + "-") + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S");
+        File recording = recordings.getNonexistentChildFile(File::createLegalFileName(name), recorder.getFileExtension());
+
+        String error = recorder.start(recording);
+        if (error.isNotEmpty())
+            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Recording", error);
+        return;
+    }
+
+    // Dropped blocks leave gaps in the file, so they are worth a warning
+    const int64 dropped = recorder.getNumDropped();
+    File recording = recorder.stop();
+    recording.revealToUser();
+    if (dropped > 0)
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "Recording", String(dropped) + " blocks were dropped because "
+                                         "the disk could not keep up, " + recording.getFileName() + " has gaps.");
+}
+
+void IconMenu::showMeters()
+{
+    if (meterWindow != nullptr && &meterWindow->getChain() == &getEditedChain())
+        return meterWindow->toFront(true);
+
+    meterWindow.reset();
+    meterWindow = std::make_unique<MeterWindow>(getEditedChain(), [this] { meterWindow.reset(); });
+}
+
+void IconMenu::reloadPlugins()
+{
+    if (pluginListWindow == nullptr)
+        pluginListWindow = std::make_unique<PluginListWindow>(*this, formatManager);
+    else
+        pluginListWindow->toFront(true);
+}
+
+void IconMenu::removePluginsLackingInputOutput()
+{
+    std::vector<PluginDescription> pluginsToRemove;
+    const auto& pluginTypes = knownPluginList.getTypes();
+    for (int i = 0; i < pluginTypes.size(); ++i)
+    {
+        const auto& pluginRef = pluginTypes.getReference(i);
+        if (pluginRef.numInputChannels < 2 || pluginRef.numOutputChannels < 2)
+        pluginsToRemove.push_back(pluginRef);
+    }
+    
+    // Remove plugins that don't have enough channels
+    for (const auto& plugin : pluginsToRemove)
+        knownPluginList.removeType(plugin);
 }
\ No newline at end of file
@@ -1,60 +1,83 @@
-//
-//  IconMenu.hpp
-//  SoftHost
-//
-//  Created by Rolando Islas on 12/26/15.
-//  Updated and optimized on 04/10/25.
-//
-
-#ifndef IconMenu_hpp
-#define IconMenu_hpp
-
-ApplicationProperties& getAppProperties();
-
-class IconMenu : public SystemTrayIconComponent, private Timer, public ChangeListener
-{
-public:
-    IconMenu();
-    ~IconMenu();
-    void mouseDown(const MouseEvent&);
-    static void menuInvocationCallback(int id, IconMenu*);
-    void changeListenerCallback(ChangeBroadcaster* changed) override;
-    static String getKey(String type, PluginDescription plugin);
-    void removePluginsLackingInputOutput();
-
-    const int INDEX_EDIT, INDEX_BYPASS, INDEX_DELETE, INDEX_MOVE_UP, INDEX_MOVE_DOWN;
-    
-private:
-    #if JUCE_MAC
-    std::string exec(const char* cmd);
-    #endif
-    void timerCallback() override;
-    void reloadPlugins();
-    void showAudioSettings();
-    void loadActivePlugins();
-    void savePluginStates();
-    void deletePluginStates();
-    PluginDescription getNextPluginOlderThanTime(int &time);
-    std::vector<PluginDescription> getTimeSortedList();
-    void setIcon();
-    
-    AudioDeviceManager deviceManager;
-    AudioPluginFormatManager formatManager;
-    KnownPluginList knownPluginList;
-    KnownPluginList activePluginList;
-    KnownPluginList::SortMethod pluginSortMethod;
-    PopupMenu menu;
-    bool menuIconLeftClicked = false;
-    AudioProcessorGraph graph;
-    AudioProcessorPlayer player;
-    AudioProcessorGraph::Node::Ptr inputNode; // Changed from raw pointer to Node::Ptr
-    AudioProcessorGraph::Node::Ptr outputNode; // Changed from raw pointer to Node::Ptr
-    #if JUCE_WINDOWS
-    int x = 0, y = 0;
-    #endif
-
-    class PluginListWindow;
-    std::unique_ptr<PluginListWindow> pluginListWindow; // Changed from ScopedPointer to std::unique_ptr
-};
-
+//
+//  IconMenu.hpp
+//  SoftHost
+//
+//  Created by Rolando Islas on 12/26/15.
+//  Updated and optimized on 04/10/25.
+//
+
+#ifndef IconMenu_hpp
+#define IconMenu_hpp
+
+#include "AudioChain.hpp"
+#include "ControlServer.hpp"
+#include "MeterWindow.hpp"
+
+void saveAppProperties();
+
+class IconMenu : public SystemTrayIconComponent, private Timer, public ChangeListener
+{
+public:
+    IconMenu();
+    ~IconMenu();
+    void mouseDown(const MouseEvent&);
+    static void menuInvocationCallback(int id, IconMenu*);
+    void changeListenerCallback(ChangeBroadcaster* changed) override;
+    void removePluginsLackingInputOutput();
+    void switchToScene(const String& name);
+
+    const int INDEX_EDIT, INDEX_BYPASS, INDEX_DELETE, INDEX_MOVE_UP, INDEX_MOVE_DOWN;
+    const int INDEX_SCENE, INDEX_SCENE_HOT, INDEX_SCENE_DELETE;
+    const int INDEX_MIDI, INDEX_MIDI_LEARN, INDEX_MIDI_CLEAR;
+    const int INDEX_CHAIN, INDEX_CHAIN_SHARE, INDEX_CHAIN_DELETE, INDEX_CHAIN_CHANNELS;
+    const int INDEX_CONTROLS, INDEX_MODULATION;
+    
+private:
+    #if JUCE_MAC
+    std::string exec(const char* cmd);
+    #endif
+    void timerCallback() override;
+    void reloadPlugins();
+    void showAudioSettings();
+    void loadActivePlugins(bool recreateInstances = false);
+    void savePluginStates();
+    void deletePluginStates();
+    void setIcon();
+    void lockMemoryWhenLoaded();
+    void toggleTracing();
+    void exportLoadReport();
+    void toggleRecording();
+    void showMeters();
+    void showNameDialog(const String& title, const String& message, std::function<void(const String&)> onCreate);
+    void showNewSceneDialog();
+    void showNewChainDialog();
+    bool addChain(const String& name);
+    void removeChain(int index);
+    void saveChainList();
+
+    // The scenes, plugins and device the menu edits belong to one chain at a time
+    AudioChain& getEditedChain() { return *chains.getUnchecked(editedChain); }
+    SceneSwitcher& getScenes() { return getEditedChain().getScenes(); }
+    PluginChain& getChain() { return getEditedChain().getChain(); }
+    AudioProcessorGraph& getGraph() { return getEditedChain().getGraph(); }
+    PluginSlot* getSlot(int index) { return getEditedChain().getSlot(index); }
+    
+    AudioPluginFormatManager formatManager;
+    KnownPluginList knownPluginList;
+    KnownPluginList::SortMethod pluginSortMethod;
+    PopupMenu menu;
+    bool menuIconLeftClicked = false;
+    OwnedArray<AudioChain> chains;
+    int editedChain = 0;
+    std::unique_ptr<AlertWindow> nameWindow;
+    std::unique_ptr<MeterWindow> meterWindow;
+    std::unique_ptr<ControlServer> controlServer;
+    #if JUCE_WINDOWS
+    int x = 0, y = 0;
+    #endif
+
+    class PluginListWindow;
+    std::unique_ptr<PluginListWindow> pluginListWindow; // Changed from ScopedPointer to std::unique_ptr
+};
+
 #endif /* IconMenu_hpp */
\ No newline at end of file
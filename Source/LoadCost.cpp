@@ -0,0 +1,102 @@
+//
+//  LoadCost.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "LoadCost.hpp"
+
+#if JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#endif
+
+namespace
+{
+    String describeGrowth(int64 bytes)
+    {
+        return (bytes < 0 ? "-" : "+") + File::descriptionOfSizeInBytes(std::abs(bytes));
+    }
+
+    String describeTime(double seconds)
+    {
+        return seconds < 1.0 ? String(roundToInt(seconds * 1000.0)) + " ms" : String(seconds, 2) + " s";
+    }
+}
+
+LoadCost::MemoryUsage LoadCost::getMemoryUsage()
+{
+    MemoryUsage usage;
+
+   #if JUCE_LINUX
+    // The rollup sums every mapping in the kernel, much cheaper than reading smaps itself. Files in /proc
+    // report a size of zero, which File and FileInputStream take as empty, so they are read with stdio
+    FILE* file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == nullptr)
+        file = fopen("/proc/self/status", "r");
+
+    if (file != nullptr)
+    {
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), file) != nullptr)
+        {
+            const String line(buffer);
+            const int64 kilobytes = line.fromFirstOccurrenceOf(":", false, false).trim().getLargeIntValue();
+            if (line.startsWith("Rss:") || line.startsWith("VmRSS:"))
+                usage.resident = kilobytes * 1024;
+            else if (line.startsWith("Pss:"))
+                usage.proportional = kilobytes * 1024;
+        }
+        fclose(file);
+    }
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        usage.resident = static_cast<int64>(info.resident_size);
+   #elif JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        usage.resident = static_cast<int64>(counters.WorkingSetSize);
+   #endif
+
+    return usage;
+}
+
+void LoadCost::setMemoryGrowth(const MemoryUsage& before, const MemoryUsage& after) noexcept
+{
+    hasResident = before.resident >= 0 && after.resident >= 0;
+    hasProportional = before.proportional >= 0 && after.proportional >= 0;
+    residentGrowth = hasResident ? after.resident - before.resident : 0;
+    proportionalGrowth = hasProportional ? after.proportional - before.proportional : 0;
+}
+
+String LoadCost::getMemorySummary() const
+{
+    if (!hasResident)
+        return "Memory: unknown";
+
+    String summary = "Memory: " + describeGrowth(residentGrowth) + " RSS";
+    if (hasProportional)
+        summary << ", " << describeGrowth(proportionalGrowth) << " PSS";
+    return summary;
+}
+
+String LoadCost::getTimeSummary() const
+{
+    return "Load: " + describeTime(instantiateSeconds) + " to create, " + describeTime(restoreSeconds)
+           + " to restore " + File::descriptionOfSizeInBytes(stateBytes) + " of state";
+}
+
+var LoadCost::toVar() const
+{
+    DynamicObject::Ptr result = new DynamicObject();
+    result->setProperty("residentGrowthBytes", hasResident ? var(residentGrowth) : var());
+    result->setProperty("proportionalGrowthBytes", hasProportional ? var(proportionalGrowth) : var());
+    result->setProperty("instantiateMs", instantiateSeconds * 1000.0);
+    result->setProperty("restoreMs", restoreSeconds * 1000.0);
+    result->setProperty("stateBytes", stateBytes);
+    return result.get();
+}
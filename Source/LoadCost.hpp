@@ -0,0 +1,38 @@
+//
+//  LoadCost.hpp
+//  SoftHost
+//
+//  What loading one plugin instance cost: how much the process's memory grew
+//  while it was created and its state restored, how long each of the two
+//  steps took, and the size of the saved state. Memory is read from the OS,
+//  so plugins loading on other threads at the same time, such as scenes
+//  loading in the background, show up in each other's figures.
+//
+
+#ifndef LoadCost_hpp
+#define LoadCost_hpp
+
+struct LoadCost
+{
+    // Bytes, -1 where the OS has no such figure. The proportional set size is only known on Linux
+    struct MemoryUsage
+    {
+        int64 resident = -1, proportional = -1;
+    };
+
+    static MemoryUsage getMemoryUsage();
+
+    void setMemoryGrowth(const MemoryUsage& before, const MemoryUsage& after) noexcept;
+
+    String getMemorySummary() const;
+    String getTimeSummary() const;
+    var toVar() const;
+
+    bool measured = false;
+    int64 residentGrowth = 0, proportionalGrowth = 0;
+    bool hasResident = false, hasProportional = false;
+    double instantiateSeconds = 0.0, restoreSeconds = 0.0;
+    int64 stateBytes = 0;
+};
+
+#endif /* LoadCost_hpp */
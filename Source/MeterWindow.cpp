@@ -0,0 +1,184 @@
+//
+//  MeterWindow.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeterWindow.hpp"
+
+namespace
+{
+    const int listWidth = 320;
+    const int rowHeight = 36;
+    const int footerHeight = 24;
+    const float minimumDecibels = -60.0f;
+    const float maximumDecibels = 6.0f;
+
+    // Displayed peaks fall back by this factor per frame once the signal drops
+    const float peakRelease = 0.8f;
+
+    float getProportion(float gain)
+    {
+        const float decibels = jlimit(minimumDecibels, maximumDecibels, Decibels::gainToDecibels(gain, minimumDecibels));
+        return jmap(decibels, minimumDecibels, maximumDecibels, 0.0f, 1.0f);
+    }
+}
+
+class MeterWindow::MeterList : public Component
+{
+public:
+    struct Row
+    {
+        String name;
+        bool metered = false;
+        PluginSlot::Levels input, output;
+    };
+
+    MeterList()
+    {
+        setSize(listWidth, footerHeight);
+    }
+
+    void update(std::vector<Row> newRows, double newCost)
+    {
+        for (size_t i = 0; i < newRows.size() && i < rows.size(); i++)
+        {
+            if (newRows[i].name != rows[i].name)
+                continue;
+
+            newRows[i].input.peak = jmax(newRows[i].input.peak, rows[i].input.peak * peakRelease);
+            newRows[i].output.peak = jmax(newRows[i].output.peak, rows[i].output.peak * peakRelease);
+        }
+
+        rows = std::move(newRows);
+        cost = newCost;
+        setSize(listWidth, static_cast<int>(rows.size()) * rowHeight + footerHeight);
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.fillAll(Colour::fromRGB(236, 236, 236));
+
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            const Row& row = rows[i];
+            juce::Rectangle<int> area(0, static_cast<int>(i) * rowHeight, getWidth(), rowHeight);
+            area.reduce(6, 3);
+
+            g.setColour(Colours::black);
+            g.setFont(12.0f);
+            g.drawText(row.metered ? row.name : row.name + " (Bypassed)", area.removeFromTop(14), Justification::centredLeft);
+
+            paintMeter(g, area.removeFromTop(8), "In", row.input, row.metered);
+            area.removeFromTop(2);
+            paintMeter(g, area.removeFromTop(8), "Out", row.output, row.metered);
+        }
+
+        g.setColour(Colours::darkgrey);
+        g.setFont(11.0f);
+        const juce::Rectangle<int> footer(6, getHeight() - footerHeight, getWidth() - 12, footerHeight);
+        g.drawText(cost >= 0.0 ? "Metering: " + String(cost * 100.0, 3) + "% of the block budget" : String("Metering: no audio"),
+                   footer, Justification::centredLeft);
+    }
+
+private:
+    static void paintMeter(Graphics& g, juce::Rectangle<int> area, const String& label, const PluginSlot::Levels& levels, bool metered)
+    {
+        g.setColour(Colours::darkgrey);
+        g.setFont(10.0f);
+        g.drawText(label, area.removeFromLeft(24), Justification::centredLeft);
+        const juce::Rectangle<int> text = area.removeFromRight(44);
+
+        g.setColour(Colours::black);
+        g.fillRect(area);
+        if (!metered)
+            return;
+
+        // RMS as the bar, peak as a marker that turns red once it reaches full scale
+        g.setColour(Colours::limegreen);
+        g.fillRect(area.withWidth(roundToInt(getProportion(levels.rms) * area.getWidth())));
+
+        const bool clipping = levels.peak >= 1.0f;
+        g.setColour(clipping ? Colours::red : Colours::yellow);
+        g.fillRect(area.getX() + roundToInt(getProportion(levels.peak) * (area.getWidth() - 2)), area.getY(), 2, area.getHeight());
+
+        const float decibels = Decibels::gainToDecibels(levels.peak, minimumDecibels);
+        g.setColour(clipping ? Colours::red : Colours::darkgrey);
+        g.drawText(decibels <= minimumDecibels ? String("-inf") : String(decibels, 1), text, Justification::centredRight);
+    }
+
+    std::vector<Row> rows;
+    double cost = -1.0;
+};
+
+MeterWindow::MeterWindow(AudioChain& chain_, std::function<void()> onClose_)
+    : DocumentWindow(chain_.isMain() ? String("Meters") : "Meters - " + chain_.getName(), Colours::lightgrey,
+                     DocumentWindow::minimiseButton | DocumentWindow::closeButton),
+      chain(chain_),
+      onClose(std::move(onClose_)),
+      list(new MeterList())
+{
+    setUsingNativeTitleBar(true);
+    setContentOwned(list, true);
+    setTopLeftPosition(80, 80);
+
+    restoreWindowStateFromString(getAppProperties().getUserSettings()->getValue("meterWindowPos"));
+    setVisible(true);
+
+    chain.getScenes().setMeteringEnabled(true);
+    lastCallbacks = chain.getPlayer().getNumCallbacks();
+    startTimerHz(30);
+}
+
+MeterWindow::~MeterWindow()
+{
+    stopTimer();
+    chain.getScenes().setMeteringEnabled(false);
+    getAppProperties().getUserSettings()->setValue("meterWindowPos", getWindowStateAsString());
+    clearContentComponent();
+}
+
+void MeterWindow::closeButtonPressed()
+{
+    // The owner deletes this window, so the callback must not be a member by the time it returns
+    auto close = onClose;
+    close();
+}
+
+void MeterWindow::timerCallback()
+{
+    PluginChain& pluginChain = chain.getChain();
+    const std::vector<PluginDescription> timeSorted = pluginChain.getTimeSortedList();
+
+    std::vector<MeterList::Row> rows;
+    int64 meteringTicks = 0;
+    for (const auto& description : timeSorted)
+    {
+        MeterList::Row row;
+        row.name = description.name;
+
+        if (auto node = PluginChain::getNodeFor(chain.getGraph(), description))
+        {
+            if (auto* slot = dynamic_cast<PluginSlot*>(node->getProcessor()))
+            {
+                row.metered = !pluginChain.isBypassed(description);
+                row.input = slot->takeInputLevels();
+                row.output = slot->takeOutputLevels();
+                meteringTicks += slot->takeMeteringTicks();
+            }
+        }
+        rows.push_back(row);
+    }
+
+    // The budget is the time the device allowed the callbacks that ran since the previous frame
+    HostPlayer& player = chain.getPlayer();
+    const int64 callbacks = player.getNumCallbacks();
+    const int64 budget = (callbacks - lastCallbacks) * player.getPeriodTicks();
+    lastCallbacks = callbacks;
+
+    if (budget > 0)
+        cost = cost * 0.9 + 0.1 * (static_cast<double>(meteringTicks) / static_cast<double>(budget));
+
+    list->update(std::move(rows), budget > 0 ? cost : -1.0);
+}
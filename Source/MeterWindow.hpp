@@ -0,0 +1,39 @@
+//
+//  MeterWindow.hpp
+//  SoftHost
+//
+//  Input and output meters for every plugin of a chain, in chain order. The
+//  levels are taken from the slots at display rate, nothing here ever waits
+//  on the audio thread. The footer shows what the metering itself costs as a
+//  share of the device's block budget.
+//
+
+#ifndef MeterWindow_hpp
+#define MeterWindow_hpp
+
+#include "AudioChain.hpp"
+
+class MeterWindow : public DocumentWindow, private Timer
+{
+public:
+    MeterWindow(AudioChain& chain, std::function<void()> onClose);
+    ~MeterWindow() override;
+
+    AudioChain& getChain() noexcept { return chain; }
+    void closeButtonPressed() override;
+
+private:
+    class MeterList;
+
+    void timerCallback() override;
+
+    AudioChain& chain;
+    std::function<void()> onClose;
+    MeterList* list;
+    int64 lastCallbacks = 0;
+    double cost = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterWindow)
+};
+
+#endif /* MeterWindow_hpp */
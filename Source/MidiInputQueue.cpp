@@ -0,0 +1,68 @@
+//
+//  MidiInputQueue.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MidiInputQueue.hpp"
+
+MidiInputQueue::MidiInputQueue()
+{
+    events.calloc(capacity);
+}
+
+void MidiInputQueue::handleIncomingMidiMessage(MidiInput*, const MidiMessage& message)
+{
+    const int size = message.getRawDataSize();
+    if (size <= 0 || size > 3)
+        return;
+
+    const SpinLock::ScopedLockType sl(writeLock);
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+    {
+        ++dropped;
+        return;
+    }
+
+    // Timestamps of incoming messages are seconds on the high resolution millisecond counter
+    Event& event = events[size1 > 0 ? start1 : start2];
+    event.time = message.getTimeStamp();
+    event.size = static_cast<uint8>(size);
+    memcpy(event.data, message.getRawData(), static_cast<size_t>(size));
+    fifo.finishedWrite(1);
+}
+
+void MidiInputQueue::removeNextBlockOfMessages(MidiBuffer& destination, int numSamples, double sampleRate) noexcept
+{
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    if (lastBlockTime <= 0.0 || sampleRate <= 0.0)
+        lastBlockTime = now - numSamples / jmax(1.0, sampleRate);
+
+    // What arrived during the previous block lands at the same offset in this one
+    auto place = [&] (int start, int count)
+    {
+        for (int i = start; i < start + count; i++)
+        {
+            const Event& event = events[i];
+            const int offset = jlimit(0, jmax(0, numSamples - 1), roundToInt((event.time - lastBlockTime) * sampleRate));
+            destination.addEvent(event.data, event.size, offset);
+        }
+    };
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    place(start1, size1);
+    place(start2, size2);
+    fifo.finishedRead(size1 + size2);
+
+    lastBlockTime = now;
+}
+
+void MidiInputQueue::reset() noexcept
+{
+    // Reader side only, so it stays safe while devices keep writing
+    fifo.finishedRead(fifo.getNumReady());
+    lastBlockTime = 0.0;
+}
@@ -0,0 +1,49 @@
+//
+//  MidiInputQueue.hpp
+//  SoftHost
+//
+//  Receives messages from every enabled MIDI input and hands them to the
+//  audio thread through a fixed size lock-free FIFO. Each message keeps its
+//  arrival time and is placed at the matching sample offset of the next
+//  block, so timing inside a block survives at the cost of one block of
+//  latency. Only short messages are queued, SysEx is ignored.
+//
+
+#ifndef MidiInputQueue_hpp
+#define MidiInputQueue_hpp
+
+class MidiInputQueue : public MidiInputCallback
+{
+public:
+    MidiInputQueue();
+
+    static const int capacity = 4096;
+
+    void handleIncomingMidiMessage(MidiInput* source, const MidiMessage& message) override;
+
+    // Reader side, the audio thread or prepareToPlay(). Never allocates as long as the destination has room reserved
+    void removeNextBlockOfMessages(MidiBuffer& destination, int numSamples, double sampleRate) noexcept;
+    void reset() noexcept;
+
+    int getNumDropped() const noexcept { return dropped; }
+
+private:
+    struct Event
+    {
+        double time;
+        uint8 data[3];
+        uint8 size;
+    };
+
+    AbstractFifo fifo { capacity };
+    HeapBlock<Event> events;
+
+    // Devices may call back on different threads, only writers share this lock
+    SpinLock writeLock;
+    std::atomic<int> dropped { 0 };
+    double lastBlockTime = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE(MidiInputQueue)
+};
+
+#endif /* MidiInputQueue_hpp */
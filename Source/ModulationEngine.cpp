@@ -0,0 +1,218 @@
+//
+//  ModulationEngine.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ModulationEngine.hpp"
+#include "SimdKernels.hpp"
+
+namespace
+{
+    const char* const typeNames[] = { "off", "lfo", "envelope", "steps" };
+    const char* const shapeNames[] = { "sine", "triangle", "square", "saw" };
+
+    // Envelopes rise this fast and fall back at the modulator's rate
+    const double envelopeAttackSeconds = 0.005;
+
+    // Changes smaller than this are not worth a call into the plugin
+    const float valueTolerance = 1.0e-4f;
+
+    int indexOf(const char* const* names, int numNames, const String& name)
+    {
+        for (int i = 0; i < numNames; i++)
+            if (name == names[i])
+                return i;
+        return 0;
+    }
+
+    float getLfoValue(ModulationEngine::Shape shape, double phase) noexcept
+    {
+        switch (shape)
+        {
+            case ModulationEngine::Triangle: return static_cast<float>(1.0 - 4.0 * std::abs(phase - 0.5));
+            case ModulationEngine::Square:   return phase < 0.5 ? 1.0f : -1.0f;
+            case ModulationEngine::Saw:      return static_cast<float>(2.0 * phase - 1.0);
+            default:                         return static_cast<float>(std::sin(MathConstants<double>::twoPi * phase));
+        }
+    }
+}
+
+ModulationEngine::~ModulationEngine()
+{
+    freeRetiredConfigs();
+    delete current;
+    delete pending.exchange(nullptr);
+}
+
+void ModulationEngine::freeRetiredConfigs()
+{
+    const auto scope = retiredFifo.read(retiredFifo.getNumReady());
+    scope.forEach([this] (int index)
+    {
+        delete retired[static_cast<size_t>(index)];
+        retired[static_cast<size_t>(index)] = nullptr;
+    });
+}
+
+void ModulationEngine::setConfig(const Config& config)
+{
+    edited = config;
+
+    // Only routings the audio thread has already let go of are freed. A pending one it never took is freed directly
+    freeRetiredConfigs();
+    delete pending.exchange(new Config(config), std::memory_order_acq_rel);
+}
+
+bool ModulationEngine::isActive() const noexcept
+{
+    for (const auto& modulator : edited.modulators)
+        if (modulator.type != Off && modulator.parameterIndex >= 0)
+            return true;
+    return false;
+}
+
+std::unique_ptr<XmlElement> ModulationEngine::createXml() const
+{
+    if (!isActive())
+        return nullptr;
+
+    auto xml = std::make_unique<XmlElement>("MODULATION");
+    for (const auto& modulator : edited.modulators)
+    {
+        if (modulator.type == Off || modulator.parameterIndex < 0)
+            continue;
+
+        auto* element = xml->createNewChildElement("MODULATOR");
+        element->setAttribute("type", typeNames[modulator.type]);
+        element->setAttribute("parameter", modulator.parameterIndex);
+        element->setAttribute("base", modulator.base);
+        element->setAttribute("depth", modulator.depth);
+        element->setAttribute("rate", modulator.rate);
+        element->setAttribute("shape", shapeNames[modulator.shape]);
+
+        StringArray steps;
+        for (int i = 0; i < modulator.numSteps; i++)
+            steps.add(String(modulator.steps[static_cast<size_t>(i)]));
+        element->setAttribute("steps", steps.joinIntoString(" "));
+    }
+    return xml;
+}
+
+void ModulationEngine::restoreFromXml(const XmlElement* xml)
+{
+    Config config;
+
+    if (xml != nullptr)
+    {
+        size_t index = 0;
+        for (auto* element : xml->getChildWithTagNameIterator("MODULATOR"))
+        {
+            if (index >= config.modulators.size())
+                break;
+
+            Modulator& modulator = config.modulators[index++];
+            modulator.type = static_cast<Type>(indexOf(typeNames, numElementsInArray(typeNames), element->getStringAttribute("type")));
+            modulator.parameterIndex = element->getIntAttribute("parameter", -1);
+            modulator.base = jlimit(0.0f, 1.0f, static_cast<float>(element->getDoubleAttribute("base", 0.5)));
+            modulator.depth = jlimit(-1.0f, 1.0f, static_cast<float>(element->getDoubleAttribute("depth", 0.5)));
+            modulator.rate = jlimit(0.01f, 50.0f, static_cast<float>(element->getDoubleAttribute("rate", 1.0)));
+            modulator.shape = static_cast<Shape>(indexOf(shapeNames, numElementsInArray(shapeNames), element->getStringAttribute("shape")));
+
+            for (const auto& step : StringArray::fromTokens(element->getStringAttribute("steps"), " ", ""))
+                if (modulator.numSteps < maxSteps)
+                    modulator.steps[static_cast<size_t>(modulator.numSteps++)] = jlimit(0.0f, 1.0f, step.getFloatValue());
+        }
+    }
+
+    setConfig(config);
+}
+
+void ModulationEngine::prepare(double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    for (auto& state : states)
+        state = State();
+}
+
+void ModulationEngine::process(const Array<AudioProcessorParameter*>& parameters, const AudioBuffer<float>& input,
+                               int numInputs, int numSamples, float chainInputLevel) noexcept
+{
+    // With nowhere to retire the current routing, the new one waits for the message thread to catch up
+    if (retiredFifo.getFreeSpace() > 0)
+    {
+        if (Config* next = pending.exchange(nullptr, std::memory_order_acq_rel))
+        {
+            const auto scope = retiredFifo.write(1);
+            retired[static_cast<size_t>(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = current;
+            current = next;
+
+            for (auto& state : states)
+                state.lastValue = -1.0f;
+        }
+    }
+
+    if (current == nullptr || numSamples <= 0)
+        return;
+
+    const double seconds = numSamples / sampleRate;
+    float inputLevel = chainInputLevel;
+
+    for (size_t i = 0; i < current->modulators.size(); i++)
+    {
+        const Modulator& modulator = current->modulators[i];
+        AudioProcessorParameter* parameter = modulator.type != Off ? parameters[modulator.parameterIndex] : nullptr;
+        if (parameter == nullptr)
+            continue;
+
+        State& state = states[i];
+        float output = 0.0f;
+
+        switch (modulator.type)
+        {
+            case LFO:
+                state.phase = std::fmod(state.phase + modulator.rate * seconds, 1.0);
+                output = getLfoValue(modulator.shape, state.phase);
+                break;
+
+            case EnvelopeFollower:
+            {
+                // Without the chain's level, the peak of the plugin's input, measured once per block for all followers
+                if (inputLevel < 0.0f)
+                {
+                    inputLevel = 0.0f;
+                    for (int channel = 0; channel < jmin(numInputs, input.getNumChannels()); channel++)
+                    {
+                        float peak, sumOfSquares;
+                        SimdKernels::peakAndSumOfSquares(input.getReadPointer(channel), numSamples, peak, sumOfSquares);
+                        inputLevel = jmax(inputLevel, peak);
+                    }
+                }
+
+                const double time = inputLevel > state.envelope ? envelopeAttackSeconds : 1.0 / modulator.rate;
+                const float coefficient = static_cast<float>(std::exp(-seconds / time));
+                state.envelope = inputLevel + (state.envelope - inputLevel) * coefficient;
+                output = jmin(1.0f, state.envelope);
+                break;
+            }
+
+            case StepSequencer:
+                if (modulator.numSteps > 0)
+                {
+                    state.phase = std::fmod(state.phase + modulator.rate * seconds, static_cast<double>(modulator.numSteps));
+                    output = modulator.steps[static_cast<size_t>(jlimit(0, modulator.numSteps - 1, static_cast<int>(state.phase)))];
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        const float value = jlimit(0.0f, 1.0f, modulator.base + modulator.depth * output);
+        if (std::abs(value - state.lastValue) > valueTolerance)
+        {
+            parameter->setValue(value);
+            state.lastValue = value;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+//
+//  ModulationEngine.hpp
+//  SoftHost
+//
+//  Host-side modulators for one plugin: LFOs, envelope followers on the
+//  chain's input and step sequencers, each routed to one parameter. They run
+//  on the audio thread right before the plugin, once per block, and write the
+//  parameters through the AudioProcessorParameter API. A routing edited on
+//  the message thread is handed over whole through an atomic pointer, and the
+//  one it replaces is freed back on the message thread, so the audio thread
+//  neither waits nor allocates.
+//
+
+#ifndef ModulationEngine_hpp
+#define ModulationEngine_hpp
+
+class ModulationEngine
+{
+public:
+    enum Type
+    {
+        Off = 0,
+        LFO,
+        EnvelopeFollower,
+        StepSequencer
+    };
+
+    enum Shape
+    {
+        Sine = 0,
+        Triangle,
+        Square,
+        Saw
+    };
+
+    static const int maxModulators = 8;
+    static const int maxSteps = 16;
+
+    // Parameter value = base + depth * output, with LFOs swinging -1 to 1 and the others 0 to 1
+    struct Modulator
+    {
+        Type type = Off;
+        int parameterIndex = -1;
+        float base = 0.5f, depth = 0.5f;
+
+        // Cycles per second for LFOs, steps per second for sequencers, release speed for envelopes
+        float rate = 1.0f;
+        Shape shape = Sine;
+        std::array<float, maxSteps> steps {};
+        int numSteps = 0;
+    };
+
+    struct Config
+    {
+        std::array<Modulator, maxModulators> modulators;
+    };
+
+    ModulationEngine() = default;
+    ~ModulationEngine();
+
+    // Message thread
+    const Config& getConfig() const noexcept { return edited; }
+    void setConfig(const Config& config);
+    bool isActive() const noexcept;
+    std::unique_ptr<XmlElement> createXml() const;
+    void restoreFromXml(const XmlElement* xml);
+
+    // Before processing starts, then on the audio thread for every block. Without a chain input
+    // level, as in offline renders, envelope followers measure the plugin's own input instead
+    void prepare(double sampleRate) noexcept;
+    void process(const Array<AudioProcessorParameter*>& parameters, const AudioBuffer<float>& input,
+                 int numInputs, int numSamples, float chainInputLevel) noexcept;
+
+private:
+    struct State
+    {
+        double phase = 0.0;
+        float envelope = 0.0f;
+        float lastValue = -1.0f;
+    };
+
+    void freeRetiredConfigs();
+
+    Config edited;
+    Config* current = nullptr;
+    std::atomic<Config*> pending { nullptr };
+
+    // Routings the audio thread replaced, freed on the message thread at the next edit
+    static const int maxRetired = 16;
+    std::array<Config*, maxRetired> retired {};
+    AbstractFifo retiredFifo { maxRetired };
+    std::array<State, maxModulators> states;
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE(ModulationEngine)
+};
+
+#endif /* ModulationEngine_hpp */
@@ -0,0 +1,305 @@
+//
+//  NullAudioDevice.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "NullAudioDevice.hpp"
+
+const String NullAudioIODeviceType::typeName("Null");
+const String NullAudioIODeviceType::realtimeDeviceName("Null Device");
+const String NullAudioIODeviceType::freeRunningDeviceName("Null Device (As Fast As Possible)");
+
+//==============================================================================
+NullAudioIODevice::NullAudioIODevice(const String& deviceName, bool freeRunning_, PropertiesFile& settings_,
+                                     const String& chainName_)
+    : AudioIODevice(deviceName, NullAudioIODeviceType::typeName),
+      Thread("Null Audio Device"),
+      freeRunning(freeRunning_),
+      settings(settings_),
+      chainName(chainName_),
+      ioThread("Null Audio Device I/O")
+{
+    formatManager.registerBasicFormats();
+}
+
+NullAudioIODevice::~NullAudioIODevice()
+{
+    close();
+}
+
+String NullAudioIODevice::getOption(const String& flag, const String& settingsKey) const
+{
+    // -null-input / -null-output on the command line take precedence over the chain's settings
+    for (const auto& param : JUCEApplicationBase::getCommandLineParameterArray())
+    {
+        if (!param.startsWith("-" + flag + "="))
+            continue;
+
+        // Every chain with a device of its own reads the same command line, only the main chain writes the file as named
+        const String value = param.fromFirstOccurrenceOf("=", false, false).unquoted();
+        if (flag != "null-output" || chainName.isEmpty())
+            return value;
+
+        const File file(File::getCurrentWorkingDirectory().getChildFile(value));
+        return file.getSiblingFile(file.getFileNameWithoutExtension() + "-" + File::createLegalFileName(chainName)
+                                   + file.getFileExtension()).getFullPathName();
+    }
+
+    return settings.getValue(settingsKey);
+}
+
+Array<double> NullAudioIODevice::getAvailableSampleRates()
+{
+    return { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+}
+
+Array<int> NullAudioIODevice::getAvailableBufferSizes()
+{
+    return { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+}
+
+String NullAudioIODevice::open(const BigInteger& inputChannels, const BigInteger& outputChannels,
+                               double newSampleRate, int bufferSizeSamples)
+{
+    close();
+
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 48000.0;
+    bufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : getDefaultBufferSize();
+    activeInputs = inputChannels;
+    activeInputs &= BigInteger(3);
+    activeOutputs = outputChannels;
+    activeOutputs &= BigInteger(3);
+    inputBuffer.setSize(2, bufferSize);
+    outputBuffer.setSize(2, bufferSize);
+    xruns = 0;
+    lastError.clear();
+
+    const String input = getOption("null-input", "nullDeviceInput");
+    generator = input.equalsIgnoreCase("sine") ? Sine : input.equalsIgnoreCase("noise") ? Noise : Silence;
+
+    if (input.isNotEmpty() && generator == Silence && !input.equalsIgnoreCase("silence"))
+    {
+        const File file(File::getCurrentWorkingDirectory().getChildFile(input));
+        if (auto* reader = formatManager.createReaderFor(file))
+        {
+            inputSource = std::make_unique<AudioFormatReaderSource>(new BufferingAudioReader(reader, ioThread, bufferSize * 64), true);
+            inputSource->setLooping(true);
+            inputSource->prepareToPlay(bufferSize, sampleRate);
+        }
+        else
+        {
+            lastError = "Unable to read " + file.getFullPathName();
+        }
+    }
+
+    const String output = getOption("null-output", "nullDeviceOutput");
+    if (output.isNotEmpty() && lastError.isEmpty())
+    {
+        const File file(File::getCurrentWorkingDirectory().getChildFile(output));
+        file.deleteFile();
+        std::unique_ptr<OutputStream> stream(file.createOutputStream());
+        AudioFormat* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+        std::unique_ptr<AudioFormatWriter> writer;
+        if (stream != nullptr && format != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+
+        if (writer != nullptr)
+        {
+            stream.release();
+            outputWriter = std::make_unique<AudioFormatWriter::ThreadedWriter>(writer.release(), ioThread, bufferSize * 64);
+        }
+        else
+        {
+            lastError = "Unable to write " + file.getFullPathName();
+        }
+    }
+
+    if (lastError.isNotEmpty())
+    {
+        inputSource.reset();
+        outputWriter.reset();
+        return lastError;
+    }
+
+    ioThread.startThread();
+    opened = true;
+    return {};
+}
+
+void NullAudioIODevice::close()
+{
+    stop();
+
+    if (!opened)
+        return;
+
+    opened = false;
+    outputWriter.reset();
+    inputSource.reset();
+    ioThread.stopThread(5000);
+}
+
+void NullAudioIODevice::start(AudioIODeviceCallback* newCallback)
+{
+    if (!opened || newCallback == nullptr)
+        return;
+
+    stop();
+    newCallback->audioDeviceAboutToStart(this);
+
+    {
+        const ScopedLock sl(callbackLock);
+        callback = newCallback;
+    }
+    startThread();
+}
+
+void NullAudioIODevice::stop()
+{
+    stopThread(5000);
+
+    AudioIODeviceCallback* lastCallback;
+    {
+        const ScopedLock sl(callbackLock);
+        lastCallback = callback;
+        callback = nullptr;
+    }
+
+    if (lastCallback != nullptr)
+        lastCallback->audioDeviceStopped();
+}
+
+void NullAudioIODevice::fillInput()
+{
+    switch (generator)
+    {
+        case Sine:
+        {
+            // 440 Hz at -12 dBFS
+            const double increment = MathConstants<double>::twoPi * 440.0 / sampleRate;
+            for (int i = 0; i < bufferSize; i++)
+            {
+                const float value = static_cast<float>(std::sin(sinePhase) * 0.25);
+                inputBuffer.setSample(0, i, value);
+                inputBuffer.setSample(1, i, value);
+                sinePhase = std::fmod(sinePhase + increment, MathConstants<double>::twoPi);
+            }
+            break;
+        }
+
+        case Noise:
+            for (int channel = 0; channel < 2; channel++)
+                for (int i = 0; i < bufferSize; i++)
+                    inputBuffer.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+            break;
+
+        case Silence:
+        default:
+            if (inputSource != nullptr)
+                inputSource->getNextAudioBlock(AudioSourceChannelInfo(&inputBuffer, 0, bufferSize));
+            else
+                inputBuffer.clear();
+            break;
+    }
+}
+
+void NullAudioIODevice::waitUntil(int64 deadline)
+{
+    const int64 ticksPerMs = Time::getHighResolutionTicksPerSecond() / 1000;
+
+    // Sleep while there is comfortably more than a millisecond left, then spin
+    for (int64 remaining = deadline - Time::getHighResolutionTicks(); remaining > 0;
+         remaining = deadline - Time::getHighResolutionTicks())
+    {
+        if (remaining > 2 * ticksPerMs)
+            Thread::sleep(static_cast<int>(remaining / ticksPerMs) - 1);
+        else
+            Thread::yield();
+    }
+}
+
+void NullAudioIODevice::run()
+{
+    const int64 period = static_cast<int64>(bufferSize / sampleRate * Time::getHighResolutionTicksPerSecond());
+    int64 deadline = Time::getHighResolutionTicks() + period;
+
+    const float* inputs[2];
+    float* outputs[2];
+    int numInputs = 0, numOutputs = 0;
+    for (int channel = 0; channel < 2; channel++)
+    {
+        if (activeInputs[channel])
+            inputs[numInputs++] = inputBuffer.getReadPointer(channel);
+        if (activeOutputs[channel])
+            outputs[numOutputs++] = outputBuffer.getWritePointer(channel);
+    }
+
+    while (!threadShouldExit())
+    {
+        fillInput();
+        for (int channel = 0; channel < 2; channel++)
+            FloatVectorOperations::clear(outputBuffer.getWritePointer(channel), bufferSize);
+
+        {
+            const ScopedLock sl(callbackLock);
+            if (callback != nullptr)
+                callback->audioDeviceIOCallbackWithContext(inputs, numInputs, outputs, numOutputs, bufferSize, {});
+        }
+
+        // Free-running there is no deadline to miss, so a full writer is waited for rather than losing the block
+        if (outputWriter != nullptr)
+        {
+            while (!outputWriter->write(outputBuffer.getArrayOfReadPointers(), bufferSize))
+            {
+                if (!freeRunning)
+                {
+                    ++xruns;
+                    break;
+                }
+
+                if (threadShouldExit())
+                    break;
+                Thread::sleep(1);
+            }
+        }
+
+        if (freeRunning)
+            continue;
+
+        // A callback that overran its period counts as an xrun and the clock is re-synchronised
+        const int64 now = Time::getHighResolutionTicks();
+        if (now > deadline)
+        {
+            ++xruns;
+            deadline = now + period;
+            continue;
+        }
+
+        waitUntil(deadline);
+        deadline += period;
+    }
+}
+
+//==============================================================================
+StringArray NullAudioIODeviceType::getDeviceNames(bool) const
+{
+    return { realtimeDeviceName, freeRunningDeviceName };
+}
+
+int NullAudioIODeviceType::getIndexOfDevice(AudioIODevice* device, bool) const
+{
+    return device != nullptr ? getDeviceNames().indexOf(device->getName()) : -1;
+}
+
+AudioIODevice* NullAudioIODeviceType::createDevice(const String& outputDeviceName, const String& inputDeviceName)
+{
+    const String name = outputDeviceName.isNotEmpty() ? outputDeviceName : inputDeviceName;
+
+    if (name == freeRunningDeviceName)
+        return new NullAudioIODevice(name, true, settings, chainName);
+    if (name == realtimeDeviceName || name.isEmpty())
+        return new NullAudioIODevice(realtimeDeviceName, false, settings, chainName);
+
+    return nullptr;
+}
@@ -0,0 +1,105 @@
+//
+//  NullAudioDevice.hpp
+//  SoftHost
+//
+//  Software audio device for machines without audio hardware and for
+//  reproducible load tests. Input comes from a file or a generator, output
+//  goes to a file or is discarded, and the callback is driven from a
+//  high-resolution clock at the configured rate and buffer size, or as fast
+//  as possible. Each chain registers its own device type with its own
+//  settings, and the output file named on the command line is suffixed with
+//  the chain's name for every chain but the main one.
+//
+
+#ifndef NullAudioDevice_hpp
+#define NullAudioDevice_hpp
+
+class NullAudioIODevice : public AudioIODevice, private Thread
+{
+public:
+    NullAudioIODevice(const String& deviceName, bool freeRunning, PropertiesFile& settings, const String& chainName);
+    ~NullAudioIODevice() override;
+
+    StringArray getOutputChannelNames() override { return { "Output 1", "Output 2" }; }
+    StringArray getInputChannelNames() override  { return { "Input 1", "Input 2" }; }
+    Array<double> getAvailableSampleRates() override;
+    Array<int> getAvailableBufferSizes() override;
+    int getDefaultBufferSize() override { return 256; }
+
+    String open(const BigInteger& inputChannels, const BigInteger& outputChannels,
+                double sampleRate, int bufferSizeSamples) override;
+    void close() override;
+    bool isOpen() override { return opened; }
+    void start(AudioIODeviceCallback* callback) override;
+    void stop() override;
+    bool isPlaying() override { return isThreadRunning(); }
+    String getLastError() override { return lastError; }
+
+    int getCurrentBufferSizeSamples() override { return bufferSize; }
+    double getCurrentSampleRate() override { return sampleRate; }
+    int getCurrentBitDepth() override { return 32; }
+    BigInteger getActiveOutputChannels() const override { return activeOutputs; }
+    BigInteger getActiveInputChannels() const override { return activeInputs; }
+    int getOutputLatencyInSamples() override { return 0; }
+    int getInputLatencyInSamples() override { return 0; }
+    int getXRunCount() const noexcept override { return xruns; }
+
+private:
+    void run() override;
+    void fillInput();
+    void waitUntil(int64 deadline);
+    String getOption(const String& flag, const String& settingsKey) const;
+
+    const bool freeRunning;
+    PropertiesFile& settings;
+    const String chainName;
+    bool opened = false;
+    double sampleRate = 48000.0;
+    int bufferSize = 256;
+    BigInteger activeInputs, activeOutputs;
+    String lastError;
+    std::atomic<int> xruns { 0 };
+
+    enum Generator { Silence, Sine, Noise };
+    Generator generator = Silence;
+    double sinePhase = 0.0;
+    Random random;
+
+    AudioBuffer<float> inputBuffer, outputBuffer;
+    TimeSliceThread ioThread;
+    AudioFormatManager formatManager;
+    std::unique_ptr<AudioFormatReaderSource> inputSource;
+    std::unique_ptr<AudioFormatWriter::ThreadedWriter> outputWriter;
+
+    CriticalSection callbackLock;
+    AudioIODeviceCallback* callback = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NullAudioIODevice)
+};
+
+class NullAudioIODeviceType : public AudioIODeviceType
+{
+public:
+    // The chain name is empty for the main chain
+    NullAudioIODeviceType(PropertiesFile& settings_, const String& chainName_)
+        : AudioIODeviceType(typeName), settings(settings_), chainName(chainName_) {}
+
+    static const String typeName;
+    static const String realtimeDeviceName;
+    static const String freeRunningDeviceName;
+
+    void scanForDevices() override {}
+    StringArray getDeviceNames(bool wantInputNames = false) const override;
+    int getDefaultDeviceIndex(bool) const override { return 0; }
+    int getIndexOfDevice(AudioIODevice* device, bool asInput) const override;
+    bool hasSeparateInputsAndOutputs() const override { return false; }
+    AudioIODevice* createDevice(const String& outputDeviceName, const String& inputDeviceName) override;
+
+private:
+    PropertiesFile& settings;
+    const String chainName;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NullAudioIODeviceType)
+};
+
+#endif /* NullAudioDevice_hpp */
@@ -0,0 +1,248 @@
+//
+//  OfflineRenderer.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Scene.hpp"
+#include "OfflineRenderer.hpp"
+
+class OfflineRenderer::Worker : public Thread
+{
+public:
+    Worker(OfflineRenderer& owner_, int index)
+        : Thread("Render Worker " + String(index)),
+          chain(owner_.formatManager, owner_.activePluginList, *getAppProperties().getUserSettings(), owner_.keyPrefix),
+          owner(owner_)
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread(10000);
+    }
+
+    void run() override
+    {
+        for (int i = owner.nextInput++; i < owner.inputs.size() && !threadShouldExit(); i = owner.nextInput++)
+            if (!owner.renderFile(*this, owner.inputs[i]))
+                ++owner.numFailed;
+
+        owner.workerFinished();
+    }
+
+    // The chain is built and prepared on the message thread, where the graph rebuilds its render
+    // sequence and latency straight away. Only re-prepared when the sample rate changes
+    bool prepare(double sampleRate)
+    {
+        if (sampleRate == preparedSampleRate)
+        {
+            graph.reset();
+            return true;
+        }
+
+        auto done = std::make_shared<WaitableEvent>();
+        std::shared_ptr<bool> isAlive = owner.alive;
+
+        MessageManager::callAsync([this, sampleRate, done, isAlive]
+        {
+            if (*isAlive)
+            {
+                if (preparedSampleRate == 0.0)
+                    chain.build(graph, sampleRate, owner.blockSize);
+                else
+                    graph.releaseResources();
+
+                graph.setNonRealtime(true);
+                graph.setPlayConfigDetails(2, 2, sampleRate, owner.blockSize);
+                graph.prepareToPlay(sampleRate, owner.blockSize);
+                preparedSampleRate = sampleRate;
+            }
+            done->signal();
+        });
+
+        while (!done->wait(50))
+            if (threadShouldExit())
+                return false;
+
+        return preparedSampleRate == sampleRate;
+    }
+
+    // The graph lives as long as the worker so plugins are torn down on the message thread
+    AudioProcessorGraph graph;
+    PluginChain chain;
+    double preparedSampleRate = 0.0;
+
+private:
+    OfflineRenderer& owner;
+};
+
+OfflineRenderer::OfflineRenderer(const Array<File>& inputFiles, const File& outputDirectory_, int numWorkers, int blockSize_)
+    : readAheadThread("Render Read-Ahead"),
+      writeBehindThread("Render Write-Behind"),
+      inputs(inputFiles),
+      outputDirectory(outputDirectory_),
+      blockSize(blockSize_),
+      keyPrefix(Scene::getKeyPrefix(Scene::getActiveName(*getAppProperties().getUserSettings())))
+{
+    formatManager.addDefaultFormats();
+    audioFormatManager.registerBasicFormats();
+
+    PluginChain chain(formatManager, activePluginList, *getAppProperties().getUserSettings(), keyPrefix);
+    chain.restoreActivePluginList();
+
+    for (int i = 0; i < jmin(numWorkers, inputs.size()); i++)
+        workers.add(new Worker(*this, i));
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    *alive = false;
+    workers.clear();
+    readAheadThread.stopThread(5000);
+    writeBehindThread.stopThread(5000);
+}
+
+Array<File> OfflineRenderer::findInputFiles(const String& argument)
+{
+    Array<File> found;
+    StringArray items;
+    items.addTokens(argument, ";", "\"");
+    items.trim();
+    items.removeEmptyStrings();
+
+    for (const auto& item : items)
+    {
+        File file = File::getCurrentWorkingDirectory().getChildFile(item.unquoted());
+        if (file.isDirectory())
+            found.addArray(file.findChildFiles(File::findFiles, false, "*.wav;*.flac"));
+        else if (file.existsAsFile())
+            found.add(file);
+        else
+            Logger::writeToLog("Render: skipping missing input " + file.getFullPathName());
+    }
+    return found;
+}
+
+void OfflineRenderer::start(std::function<void(int numFailed)> onFinished)
+{
+    finishedCallback = std::move(onFinished);
+
+    if (workers.isEmpty())
+    {
+        Logger::writeToLog("Render: no input files");
+        MessageManager::callAsync([this] { finishedCallback(1); });
+        return;
+    }
+
+    outputDirectory.createDirectory();
+    readAheadThread.startThread();
+    writeBehindThread.startThread();
+
+    Logger::writeToLog("Render: " + String(inputs.size()) + " file(s) on " + String(workers.size()) + " worker(s), "
+                       + String(blockSize) + " sample blocks");
+
+    numRunning = workers.size();
+    for (auto* worker : workers)
+        worker->startThread();
+}
+
+void OfflineRenderer::workerFinished()
+{
+    if (--numRunning == 0)
+        MessageManager::callAsync([this] { finishedCallback(numFailed); });
+}
+
+File OfflineRenderer::getOutputFileFor(const File& input) const
+{
+    const String extension = input.hasFileExtension("flac") ? ".flac" : ".wav";
+    File output = outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+
+    // Never overwrite the source when rendering in place
+    if (output == input)
+        output = outputDirectory.getChildFile(input.getFileNameWithoutExtension() + "-rendered" + extension);
+
+    return output;
+}
+
+bool OfflineRenderer::renderFile(Worker& worker, const File& input)
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    std::unique_ptr<AudioFormatReader> source(audioFormatManager.createReaderFor(input));
+    if (source == nullptr)
+    {
+        Logger::writeToLog("Render: unable to read " + input.getFullPathName());
+        return false;
+    }
+
+    const double sampleRate = source->sampleRate;
+    const int64 length = source->lengthInSamples;
+    const int sourceBitDepth = static_cast<int>(source->bitsPerSample);
+
+    if (!worker.prepare(sampleRate))
+        return false;
+
+    BufferingAudioReader reader(source.release(), readAheadThread, blockSize * 32);
+    reader.setReadTimeout(-1);
+
+    const File output = getOutputFileFor(input);
+    AudioFormat* format = audioFormatManager.findFormatForFileExtension(output.getFileExtension());
+    output.deleteFile();
+    std::unique_ptr<OutputStream> stream(output.createOutputStream());
+    if (format == nullptr || stream == nullptr)
+    {
+        Logger::writeToLog("Render: unable to create " + output.getFullPathName());
+        return false;
+    }
+
+    const int bitDepth = format->getPossibleBitDepths().contains(sourceBitDepth) ? sourceBitDepth : 24;
+    std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, 2, bitDepth, {}, 0));
+    if (writer == nullptr)
+    {
+        Logger::writeToLog("Render: unable to write " + output.getFullPathName());
+        return false;
+    }
+    stream.release(); // Owned by the writer now
+
+    AudioFormatWriter::ThreadedWriter threadedWriter(writer.release(), writeBehindThread, blockSize * 32);
+
+    // Skip the chain latency at the start and flush it with silence at the end
+    AudioBuffer<float> buffer(2, blockSize);
+    MidiBuffer midi;
+    int64 readPosition = 0;
+    int64 samplesToSkip = worker.graph.getLatencySamples();
+    int64 samplesToWrite = length;
+
+    while (samplesToWrite > 0)
+    {
+        if (worker.threadShouldExit())
+            return false;
+
+        buffer.clear();
+        const int numToRead = static_cast<int>(jlimit<int64>(0, blockSize, length - readPosition));
+        if (numToRead > 0)
+            reader.read(&buffer, 0, numToRead, readPosition, true, true);
+        readPosition += blockSize;
+
+        worker.graph.processBlock(buffer, midi);
+        midi.clear();
+
+        const int offset = static_cast<int>(jmin<int64>(samplesToSkip, blockSize));
+        const int numToWrite = static_cast<int>(jmin<int64>(blockSize - offset, samplesToWrite));
+        samplesToSkip -= offset;
+
+        if (numToWrite > 0)
+        {
+            const float* channels[] = { buffer.getReadPointer(0, offset), buffer.getReadPointer(1, offset), nullptr };
+            while (!threadedWriter.write(channels, numToWrite))
+                Thread::sleep(1);
+            samplesToWrite -= numToWrite;
+        }
+    }
+
+    const double seconds = (Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    Logger::writeToLog("Render: " + input.getFileName() + " -> " + output.getFullPathName()
+                       + " (" + String((length / sampleRate) / jmax(seconds, 0.001), 1) + "x realtime)");
+    return true;
+}
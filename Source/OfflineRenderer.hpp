@@ -0,0 +1,51 @@
+//
+//  OfflineRenderer.hpp
+//  SoftHost
+//
+//  Headless mode that streams audio files through the active scene's chain as
+//  fast as the CPU allows. Each worker thread owns its own chain instance and
+//  pulls files from a shared queue; disk reads and writes are buffered on
+//  their own background threads.
+//
+
+#ifndef OfflineRenderer_hpp
+#define OfflineRenderer_hpp
+
+ApplicationProperties& getAppProperties();
+
+class OfflineRenderer
+{
+public:
+    OfflineRenderer(const Array<File>& inputFiles, const File& outputDirectory, int numWorkers, int blockSize);
+    ~OfflineRenderer();
+
+    void start(std::function<void(int numFailed)> onFinished);
+
+    static Array<File> findInputFiles(const String& argument);
+
+private:
+    class Worker;
+
+    bool renderFile(Worker& worker, const File& input);
+    File getOutputFileFor(const File& input) const;
+    void workerFinished();
+
+    AudioPluginFormatManager formatManager;
+    AudioFormatManager audioFormatManager;
+    KnownPluginList activePluginList;
+    TimeSliceThread readAheadThread, writeBehindThread;
+
+    Array<File> inputs;
+    File outputDirectory;
+    const int blockSize;
+    const String keyPrefix;
+
+    OwnedArray<Worker> workers;
+    std::atomic<int> nextInput { 0 }, numFailed { 0 }, numRunning { 0 };
+    std::function<void(int)> finishedCallback;
+    std::shared_ptr<bool> alive { std::make_shared<bool>(true) };
+
+    JUCE_DECLARE_NON_COPYABLE(OfflineRenderer)
+};
+
+#endif /* OfflineRenderer_hpp */
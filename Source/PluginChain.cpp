@@ -0,0 +1,450 @@
+//
+//  PluginChain.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginChain.hpp"
+#include "PluginSlot.hpp"
+#include "Tracer.hpp"
+#include <limits.h>
+#include <ctime>
+
+const AudioProcessorGraph::NodeID PluginChain::INPUT(1000000);
+const AudioProcessorGraph::NodeID PluginChain::OUTPUT(1000001);
+const AudioProcessorGraph::NodeID PluginChain::MIDI_INPUT(1000002);
+
+namespace
+{
+    // Every per-plugin key a chain owns, copied and deleted together
+    const char* const pluginKeyTypes[] = { "order", "bypass", "state", "midi", "midimap", "controls", "modulation" };
+}
+
+PluginChain::PluginChain(AudioPluginFormatManager& formatManager_, KnownPluginList& activePluginList_,
+                         PropertiesFile& settings_, const String& keyPrefix_)
+    : formatManager(formatManager_),
+      activePluginList(activePluginList_),
+      settings(settings_),
+      keyPrefix(keyPrefix_)
+{
+}
+
+String PluginChain::getIdentifier(const PluginDescription& plugin)
+{
+    return plugin.name + plugin.version + plugin.pluginFormatName;
+}
+
+String PluginChain::getKey(String type, const PluginDescription& plugin) const
+{
+    return keyPrefix + "plugin-" + type.toLowerCase() + "-" + getIdentifier(plugin);
+}
+
+String PluginChain::getListKey() const
+{
+    return keyPrefix + "pluginListActive";
+}
+
+void PluginChain::restoreActivePluginList()
+{
+    std::unique_ptr<XmlElement> savedPluginListActive(settings.getXmlValue(getListKey()));
+    if (savedPluginListActive != nullptr)
+        activePluginList.recreateFromXml(*savedPluginListActive);
+}
+
+void PluginChain::saveActivePluginList()
+{
+    std::unique_ptr<XmlElement> savedPluginList(activePluginList.createXml());
+    if (savedPluginList != nullptr)
+        settings.setValue(getListKey(), savedPluginList.get());
+}
+
+bool PluginChain::isBypassed(const PluginDescription& plugin) const
+{
+    return settings.getBoolValue(getKey("bypass", plugin), false);
+}
+
+bool PluginChain::receivesMidi(const PluginDescription& plugin, AudioProcessor* processor) const
+{
+    auto* instance = PluginSlot::getPluginFor(processor);
+    return settings.getBoolValue(getKey("midi", plugin), instance != nullptr && instance->acceptsMidi());
+}
+
+void PluginChain::build(AudioProcessorGraph& graph, double sampleRate, int blockSize)
+{
+    graph.clear();
+    sync(graph, sampleRate, blockSize);
+}
+
+void PluginChain::sync(AudioProcessorGraph& graph, double sampleRate, int blockSize,
+                       std::function<void(AudioProcessorGraph::Node*)> nodeRemoved)
+{
+    const int CHANNEL_ONE = 0;
+    const int CHANNEL_TWO = 1;
+
+    const TraceScope trace("Sync Chain");
+
+    if (graph.getNodeForId(INPUT) == nullptr)
+        graph.addNode(std::make_unique<AudioProcessorGraph::AudioGraphIOProcessor>(
+            AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode), INPUT);
+    if (graph.getNodeForId(OUTPUT) == nullptr)
+        graph.addNode(std::make_unique<AudioProcessorGraph::AudioGraphIOProcessor>(
+            AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode), OUTPUT);
+    if (graph.getNodeForId(MIDI_INPUT) == nullptr)
+        graph.addNode(std::make_unique<AudioProcessorGraph::AudioGraphIOProcessor>(
+            AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode), MIDI_INPUT);
+
+    std::vector<PluginDescription> list = getTimeSortedList();
+    StringArray identifiers;
+    for (const auto& plugin : list)
+        identifiers.add(getIdentifier(plugin));
+
+    // Drop the nodes of plugins that left the chain
+    Array<AudioProcessorGraph::Node::Ptr> removed;
+    for (auto* node : graph.getNodes())
+    {
+        const String identifier = node->properties["plugin"];
+        if (identifier.isNotEmpty() && !identifiers.contains(identifier))
+            removed.add(node);
+    }
+    for (auto& node : removed)
+    {
+        if (nodeRemoved != nullptr)
+            nodeRemoved(node.get());
+        graph.removeNode(node->nodeID);
+    }
+
+    // Create what is missing and chain everything that isn't bypassed, in order
+    std::vector<AudioProcessorGraph::Connection> connections;
+    AudioProcessorGraph::NodeID lastId = INPUT;
+
+    for (const auto& plugin : list)
+    {
+        AudioProcessorGraph::Node::Ptr node = getNodeFor(graph, plugin);
+        if (node == nullptr)
+        {
+            if (isAborted())
+                break;
+            node = createNode(graph, plugin, sampleRate, blockSize);
+        }
+
+        if (node == nullptr || isBypassed(plugin))
+            continue;
+
+        if (receivesMidi(plugin, node->getProcessor()))
+            connections.push_back({{MIDI_INPUT, AudioProcessorGraph::midiChannelIndex},
+                                   {node->nodeID, AudioProcessorGraph::midiChannelIndex}});
+
+        connections.push_back({{lastId, CHANNEL_ONE}, {node->nodeID, CHANNEL_ONE}});
+        connections.push_back({{lastId, CHANNEL_TWO}, {node->nodeID, CHANNEL_TWO}});
+        lastId = node->nodeID;
+    }
+
+    connections.push_back({{lastId, CHANNEL_ONE}, {OUTPUT, CHANNEL_ONE}});
+    connections.push_back({{lastId, CHANNEL_TWO}, {OUTPUT, CHANNEL_TWO}});
+
+    // Only touch the connections that changed
+    for (const auto& connection : graph.getConnections())
+        if (std::find(connections.begin(), connections.end(), connection) == connections.end())
+            graph.removeConnection(connection);
+
+    for (const auto& connection : connections)
+        if (!graph.isConnected(connection))
+            graph.addConnection(connection);
+}
+
+AudioProcessorGraph::Node::Ptr PluginChain::createNode(AudioProcessorGraph& graph, const PluginDescription& plugin,
+                                                       double sampleRate, int blockSize)
+{
+    String errorMessage;
+    std::unique_ptr<AudioPluginInstance> instance;
+    LoadCost cost;
+    const LoadCost::MemoryUsage memoryBefore = LoadCost::getMemoryUsage();
+    double started = Time::getMillisecondCounterHiRes();
+
+    {
+        const TraceScope trace("Instantiate Plugin");
+        if (abortFlag == nullptr || MessageManager::getInstance()->isThisTheMessageThread())
+            instance = formatManager.createPluginInstance(plugin, sampleRate, blockSize, errorMessage);
+        else
+            instance = createInstanceUnlessAborted(plugin, sampleRate, blockSize, errorMessage);
+    }
+
+    if (instance == nullptr)
+        return nullptr;
+
+    cost.instantiateSeconds = (Time::getMillisecondCounterHiRes() - started) / 1000.0;
+    started = Time::getMillisecondCounterHiRes();
+    auto slot = std::make_unique<PluginSlot>(std::move(instance));
+
+    // Restore plugin state
+    {
+        const TraceScope trace("Restore State", slot->getTraceId());
+        String savedPluginState = settings.getValue(getKey("state", plugin));
+        MemoryBlock savedPluginBinary;
+        savedPluginBinary.fromBase64Encoding(savedPluginState);
+        if (savedPluginBinary.getSize() > 0)
+            slot->setStateInformation(savedPluginBinary.getData(), static_cast<int>(savedPluginBinary.getSize()));
+        slot->setMidiMappings(settings.getValue(getKey("midimap", plugin)));
+        slot->setControls(settings.getValue(getKey("controls", plugin)));
+
+        std::unique_ptr<XmlElement> modulation(settings.getXmlValue(getKey("modulation", plugin)));
+        slot->getModulation().restoreFromXml(modulation.get());
+        slot->setChainInputLevel(chainInputLevel);
+        slot->setMeteringFlag(chainMetering);
+        slot->onLatencyChanged = [&graph] { graph.rebuild(); };
+        cost.stateBytes = static_cast<int64>(savedPluginBinary.getSize());
+    }
+
+    cost.restoreSeconds = (Time::getMillisecondCounterHiRes() - started) / 1000.0;
+    cost.setMemoryGrowth(memoryBefore, LoadCost::getMemoryUsage());
+    cost.measured = true;
+    slot->setLoadCost(cost);
+
+    AudioProcessorGraph::Node::Ptr node = graph.addNode(std::move(slot));
+    if (node != nullptr)
+        node->properties.set("plugin", getIdentifier(plugin));
+    return node;
+}
+
+std::unique_ptr<AudioPluginInstance> PluginChain::createInstanceUnlessAborted(const PluginDescription& plugin, double sampleRate,
+                                                                              int blockSize, String& errorMessage)
+{
+    // The instance is made on the message thread. Waiting for it in slices means a message thread that
+    // is itself waiting for this build, as at shutdown, can abort it instead of deadlocking
+    struct Creation
+    {
+        std::unique_ptr<AudioPluginInstance> instance;
+        String error;
+        WaitableEvent done;
+    };
+    auto creation = std::make_shared<Creation>();
+
+    formatManager.createPluginInstanceAsync(plugin, sampleRate, blockSize,
+                                            [creation] (std::unique_ptr<AudioPluginInstance> instance, const String& error)
+    {
+        creation->instance = std::move(instance);
+        creation->error = error;
+        creation->done.signal();
+    });
+
+    while (!creation->done.wait(50))
+        if (isAborted())
+            return nullptr;
+
+    errorMessage = creation->error;
+    return std::move(creation->instance);
+}
+
+AudioProcessorGraph::Node::Ptr PluginChain::getNodeFor(AudioProcessorGraph& graph, const PluginDescription& plugin)
+{
+    const String identifier = getIdentifier(plugin);
+    for (auto* node : graph.getNodes())
+        if (node->properties["plugin"].toString() == identifier)
+            return node;
+
+    return nullptr;
+}
+
+Array<AudioProcessorGraph::Node::Ptr> PluginChain::getProcessingOrder(AudioProcessorGraph& graph)
+{
+    // Follows the first channel from the input node, skipping bypassed plugins
+    Array<AudioProcessorGraph::Node::Ptr> order;
+    AudioProcessorGraph::NodeID current = INPUT;
+
+    for (;;)
+    {
+        AudioProcessorGraph::NodeID next;
+        for (const auto& connection : graph.getConnections())
+            if (connection.source.nodeID == current && connection.source.channelIndex == 0)
+                next = connection.destination.nodeID;
+
+        if (next == AudioProcessorGraph::NodeID() || next == OUTPUT)
+            return order;
+
+        auto node = graph.getNodeForId(next);
+        if (node == nullptr || order.contains(node))
+            return order;
+
+        order.add(node);
+        current = next;
+    }
+}
+
+void PluginChain::addPlugin(const PluginDescription& plugin)
+{
+    settings.setValue(getKey("order", plugin), static_cast<int>(time(nullptr)));
+    activePluginList.addType(plugin);
+}
+
+void PluginChain::removePlugin(int index)
+{
+    std::vector<PluginDescription> timeSorted = getTimeSortedList();
+    if (!isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        return;
+
+    const PluginDescription plugin = timeSorted[index];
+    for (auto* type : pluginKeyTypes)
+        settings.removeValue(getKey(type, plugin));
+
+    for (int i = 0; i < activePluginList.getNumTypes(); i++)
+    {
+        const auto& current = activePluginList.getTypes().getReference(i);
+        if (getIdentifier(current) == getIdentifier(plugin))
+        {
+            activePluginList.removeType(current);
+            break;
+        }
+    }
+}
+
+void PluginChain::toggleBypass(int index)
+{
+    std::vector<PluginDescription> timeSorted = getTimeSortedList();
+    if (!isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        return;
+
+    String key = getKey("bypass", timeSorted[index]);
+    settings.setValue(key, !settings.getBoolValue(key));
+}
+
+void PluginChain::setReceivesMidi(int index, bool shouldReceiveMidi)
+{
+    std::vector<PluginDescription> timeSorted = getTimeSortedList();
+    if (isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        settings.setValue(getKey("midi", timeSorted[index]), shouldReceiveMidi);
+}
+
+void PluginChain::moveUp(int index)
+{
+    std::vector<PluginDescription> timeSorted = getTimeSortedList();
+    if (!isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        return;
+
+    // Orders are rewritten as 1..n with the moved plugin swapped with its predecessor
+    for (int i = 0; i < timeSorted.size(); i++)
+    {
+        bool move = i == index;
+        settings.setValue(getKey("order", timeSorted[i]), move ? i : i + 1);
+        if (move && i > 0)
+            settings.setValue(getKey("order", timeSorted[i - 1]), i + 1);
+    }
+}
+
+void PluginChain::moveDown(int index)
+{
+    std::vector<PluginDescription> timeSorted = getTimeSortedList();
+    if (!isPositiveAndBelow(index, static_cast<int>(timeSorted.size())))
+        return;
+
+    for (int i = 0; i < timeSorted.size(); i++)
+    {
+        bool move = i == index;
+        settings.setValue(getKey("order", timeSorted[i]), move ? i + 2 : i + 1);
+        if (move && i + 1 < timeSorted.size())
+        {
+            settings.setValue(getKey("order", timeSorted[i + 1]), i + 1);
+            i++;
+        }
+    }
+}
+
+void PluginChain::copySettingsTo(PluginChain& other)
+{
+    other.activePluginList.clear();
+    for (const auto& plugin : activePluginList.getTypes())
+    {
+        for (auto* type : pluginKeyTypes)
+            if (settings.containsKey(getKey(type, plugin)))
+                other.settings.setValue(other.getKey(type, plugin), settings.getValue(getKey(type, plugin)));
+        other.activePluginList.addType(plugin);
+    }
+    other.saveActivePluginList();
+}
+
+void PluginChain::deleteSettings()
+{
+    for (const auto& plugin : activePluginList.getTypes())
+        for (auto* type : pluginKeyTypes)
+            settings.removeValue(getKey(type, plugin));
+    settings.removeValue(getListKey());
+}
+
+PluginDescription PluginChain::getNextPluginOlderThanTime(int &time) const
+{
+    int timeStatic = time;
+    PluginDescription closest;
+    int diff = INT_MAX;
+
+    for (int i = 0; i < activePluginList.getNumTypes(); i++)
+    {
+        const auto& plugin = activePluginList.getTypes().getReference(i);
+        int pluginTime = settings.getValue(getKey("order", plugin)).getIntValue();
+
+        if (pluginTime > timeStatic && abs(timeStatic - pluginTime) < diff)
+        {
+            diff = abs(timeStatic - pluginTime);
+            closest = plugin;
+            time = pluginTime;
+        }
+    }
+    return closest;
+}
+
+std::vector<PluginDescription> PluginChain::getTimeSortedList() const
+{
+    int time = 0;
+    std::vector<PluginDescription> list;
+    list.reserve(activePluginList.getNumTypes());
+
+    for (int i = 0; i < activePluginList.getNumTypes(); i++)
+        list.push_back(getNextPluginOlderThanTime(time));
+
+    return list;
+}
+
+void PluginChain::deleteStates()
+{
+    const TraceScope trace("deletePluginStates");
+    std::vector<PluginDescription> list = getTimeSortedList();
+    for (int i = 0; i < list.size(); i++)
+        settings.removeValue(getKey("state", list[i]));
+    const TraceScope saveTrace("saveIfNeeded");
+    settings.saveIfNeeded();
+}
+
+void PluginChain::saveStates(AudioProcessorGraph& graph)
+{
+    const TraceScope trace("savePluginStates");
+    for (const auto& plugin : getTimeSortedList())
+    {
+        auto node = getNodeFor(graph, plugin);
+        if (node == nullptr || node->getProcessor() == nullptr)
+            continue;
+
+        MemoryBlock savedStateBinary;
+        node->getProcessor()->getStateInformation(savedStateBinary);
+
+        if (savedStateBinary.getSize() > 0)
+            settings.setValue(getKey("state", plugin), savedStateBinary.toBase64Encoding());
+
+        if (auto* slot = dynamic_cast<PluginSlot*>(node->getProcessor()))
+        {
+            if (slot->hasMidiMappings())
+                settings.setValue(getKey("midimap", plugin), slot->getMidiMappings());
+            else
+                settings.removeValue(getKey("midimap", plugin));
+
+            if (slot->hasDefaultControls())
+                settings.removeValue(getKey("controls", plugin));
+            else
+                settings.setValue(getKey("controls", plugin), slot->getControls());
+
+            if (auto modulation = slot->getModulation().createXml())
+                settings.setValue(getKey("modulation", plugin), modulation.get());
+            else
+                settings.removeValue(getKey("modulation", plugin));
+        }
+    }
+    const TraceScope saveTrace("saveIfNeeded");
+    settings.saveIfNeeded();
+}
@@ -0,0 +1,82 @@
+//
+//  PluginChain.hpp
+//  SoftHost
+//
+//  Builds the active plugin chain into an AudioProcessorGraph and keeps the
+//  per-plugin order, bypass and state keys in one place, so the tray host and
+//  the headless modes load exactly the same chain. Every key is prefixed, so
+//  each scene keeps its own chain in the same settings file.
+//
+
+#ifndef PluginChain_hpp
+#define PluginChain_hpp
+
+class PluginChain
+{
+public:
+    PluginChain(AudioPluginFormatManager& formatManager, KnownPluginList& activePluginList, PropertiesFile& settings,
+                const String& keyPrefix = String());
+
+    static const AudioProcessorGraph::NodeID INPUT;
+    static const AudioProcessorGraph::NodeID OUTPUT;
+    static const AudioProcessorGraph::NodeID MIDI_INPUT;
+
+    static String getIdentifier(const PluginDescription& plugin);
+    String getKey(String type, const PluginDescription& plugin) const;
+    String getListKey() const;
+
+    void restoreActivePluginList();
+    void saveActivePluginList();
+
+    std::vector<PluginDescription> getTimeSortedList() const;
+    bool isBypassed(const PluginDescription& plugin) const;
+
+    // Plugins that take MIDI receive it unless turned off, others only when turned on
+    bool receivesMidi(const PluginDescription& plugin, AudioProcessor* processor) const;
+
+    // Edits take indexes into getTimeSortedList() and only touch the settings
+    void addPlugin(const PluginDescription& plugin);
+    void removePlugin(int index);
+    void toggleBypass(int index);
+    void setReceivesMidi(int index, bool shouldReceiveMidi);
+    void moveUp(int index);
+    void moveDown(int index);
+    void copySettingsTo(PluginChain& other);
+    void deleteSettings();
+
+    // build() recreates every plugin, sync() keeps the instances that are still in the chain
+    void build(AudioProcessorGraph& graph, double sampleRate, int blockSize);
+    void sync(AudioProcessorGraph& graph, double sampleRate, int blockSize,
+              std::function<void(AudioProcessorGraph::Node*)> nodeRemoved = nullptr);
+    static AudioProcessorGraph::Node::Ptr getNodeFor(AudioProcessorGraph& graph, const PluginDescription& plugin);
+    static Array<AudioProcessorGraph::Node::Ptr> getProcessingOrder(AudioProcessorGraph& graph);
+    void saveStates(AudioProcessorGraph& graph);
+    void deleteStates();
+
+    // Handed to every slot created from now on, for the envelope followers of their modulators
+    void setChainInputLevel(const std::atomic<float>* level) noexcept { chainInputLevel = level; }
+    void setMeteringFlag(const std::atomic<bool>* flag) noexcept { chainMetering = flag; }
+
+    // Once set, a build on a background thread creates no more plugins and stops waiting for the one in progress
+    void setAbortFlag(const std::atomic<bool>* flag) noexcept { abortFlag = flag; }
+
+private:
+    PluginDescription getNextPluginOlderThanTime(int &time) const;
+    AudioProcessorGraph::Node::Ptr createNode(AudioProcessorGraph& graph, const PluginDescription& plugin,
+                                              double sampleRate, int blockSize);
+    std::unique_ptr<AudioPluginInstance> createInstanceUnlessAborted(const PluginDescription& plugin, double sampleRate,
+                                                                     int blockSize, String& errorMessage);
+    bool isAborted() const noexcept { return abortFlag != nullptr && abortFlag->load(); }
+
+    AudioPluginFormatManager& formatManager;
+    KnownPluginList& activePluginList;
+    PropertiesFile& settings;
+    const String keyPrefix;
+    const std::atomic<float>* chainInputLevel = nullptr;
+    const std::atomic<bool>* chainMetering = nullptr;
+    const std::atomic<bool>* abortFlag = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE(PluginChain)
+};
+
+#endif /* PluginChain_hpp */
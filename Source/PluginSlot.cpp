@@ -0,0 +1,438 @@
+//
+//  PluginSlot.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginSlot.hpp"
+#include "SimdKernels.hpp"
+#include "Tracer.hpp"
+
+PluginSlot::PluginSlot(std::unique_ptr<AudioPluginInstance> plugin_)
+    : AudioProcessor(getBusesPropertiesFor(*plugin_)),
+      plugin(std::move(plugin_)),
+      traceId(Tracer::createId(plugin->getName()))
+{
+    for (auto& parameterIndex : controllerMap)
+        parameterIndex = -1;
+    plugin->addListener(this);
+
+    addParameter(inputTrim = new AudioParameterFloat(ParameterID("inputTrim", 1), "Input Trim", NormalisableRange<float>(-24.0f, 24.0f, 0.1f),
+                                                     0.0f, AudioParameterFloatAttributes().withLabel("dB")));
+    addParameter(outputTrim = new AudioParameterFloat(ParameterID("outputTrim", 1), "Output Trim", NormalisableRange<float>(-24.0f, 24.0f, 0.1f),
+                                                      0.0f, AudioParameterFloatAttributes().withLabel("dB")));
+    addParameter(mix = new AudioParameterFloat(ParameterID("mix", 1), "Mix", NormalisableRange<float>(0.0f, 100.0f, 0.1f),
+                                               100.0f, AudioParameterFloatAttributes().withLabel("%")));
+
+    // The slot's controls come after the plugin's and can be learned from its own editor too
+    automatable.addArray(plugin->getParameters());
+    automatable.addArray(getParameters());
+    addListener(this);
+}
+
+PluginSlot::~PluginSlot()
+{
+    removeListener(this);
+    plugin->removeListener(this);
+}
+
+AudioPluginInstance* PluginSlot::getPluginFor(AudioProcessor* processor)
+{
+    if (auto* slot = dynamic_cast<PluginSlot*>(processor))
+        return &slot->getPlugin();
+
+    return dynamic_cast<AudioPluginInstance*>(processor);
+}
+
+AudioProcessor::BusesProperties PluginSlot::getBusesPropertiesFor(AudioPluginInstance& plugin)
+{
+    BusesProperties properties;
+
+    for (int i = 0; i < plugin.getBusCount(true); i++)
+        if (auto* bus = plugin.getBus(true, i))
+            properties.addBus(true, bus->getName(), bus->getCurrentLayout(), bus->isEnabled());
+
+    for (int i = 0; i < plugin.getBusCount(false); i++)
+        if (auto* bus = plugin.getBus(false, i))
+            properties.addBus(false, bus->getName(), bus->getCurrentLayout(), bus->isEnabled());
+
+    return properties;
+}
+
+bool PluginSlot::canPrepareConcurrently() const
+{
+    return plugin->getPluginDescription().pluginFormatName != "VST3";
+}
+
+void PluginSlot::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    // The scene may already have prepared this slot ahead of the graph, see SceneSwitcher::prepareScene()
+    if (sampleRate == preparedSampleRate && maximumExpectedSamplesPerBlock == preparedBlockSize)
+        return;
+
+    const TraceScope trace("Prepare Plugin", traceId);
+
+    if (plugin->getBusesLayout() != getBusesLayout())
+        plugin->setBusesLayout(getBusesLayout());
+
+    plugin->setRateAndBufferSizeDetails(sampleRate, maximumExpectedSamplesPerBlock);
+    plugin->prepareToPlay(sampleRate, maximumExpectedSamplesPerBlock);
+    setLatencySamples(plugin->getLatencySamples());
+
+    // The dry path waits for the plugin's latency so both line up again at the mix
+    dryLatency = jmax(0, plugin->getLatencySamples());
+    const int numDryChannels = jmax(1, getTotalNumInputChannels());
+    dryBuffer.setSize(numDryChannels, maximumExpectedSamplesPerBlock);
+    dryDelay.setSize(numDryChannels, dryLatency + maximumExpectedSamplesPerBlock);
+    dryDelay.clear();
+    dryDelayPosition = 0;
+    dryActive = false;
+
+    inputGain.reset(sampleRate, 0.02);
+    outputGain.reset(sampleRate, 0.02);
+    wetAmount.reset(sampleRate, 0.02);
+    inputGain.setCurrentAndTargetValue(Decibels::decibelsToGain(inputTrim->get()));
+    outputGain.setCurrentAndTargetValue(Decibels::decibelsToGain(outputTrim->get()));
+    wetAmount.setCurrentAndTargetValue(mix->get() / 100.0f);
+    modulation.prepare(sampleRate);
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = maximumExpectedSamplesPerBlock;
+}
+
+void PluginSlot::releaseResources()
+{
+    plugin->releaseResources();
+    preparedSampleRate = 0.0;
+    preparedBlockSize = 0;
+}
+
+void PluginSlot::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(isNonRealtime);
+    plugin->setNonRealtime(isNonRealtime);
+}
+
+void PluginSlot::audioProcessorParameterChangeGestureBegin(AudioProcessor* processor, int parameterIndex)
+{
+    lastTouchedParameter = processor == plugin.get() ? parameterIndex : plugin->getParameters().size() + parameterIndex;
+}
+
+void PluginSlot::audioProcessorChanged(AudioProcessor* processor, const ChangeDetails& details)
+{
+    // Plugins report this from any thread, the new delay line is allocated on the message thread
+    if (processor == plugin.get() && details.latencyChanged)
+        triggerAsyncUpdate();
+}
+
+void PluginSlot::handleAsyncUpdate()
+{
+    const int latency = jmax(0, plugin->getLatencySamples());
+    if (latency == getLatencySamples())
+        return;
+
+    if (preparedBlockSize > 0)
+    {
+        AudioBuffer<float> delay(dryDelay.getNumChannels(), latency + preparedBlockSize);
+        delay.clear();
+
+        const ScopedLock sl(getCallbackLock());
+        std::swap(dryDelay, delay);
+        dryLatency = latency;
+        dryDelayPosition = 0;
+        dryActive = false;
+    }
+
+    setLatencySamples(latency);
+    if (onLatencyChanged != nullptr)
+        onLatencyChanged();
+}
+
+void PluginSlot::setLearning(bool shouldLearn) noexcept
+{
+    lastTouchedParameter = -1;
+    learning = shouldLearn;
+}
+
+String PluginSlot::getMidiMappings() const
+{
+    StringArray mappings;
+    for (int i = 0; i < static_cast<int>(controllerMap.size()); i++)
+        if (controllerMap[i] >= 0)
+            mappings.add(String(i / 128 + 1) + ":" + String(i % 128) + "=" + String(controllerMap[i].load()));
+    return mappings.joinIntoString(",");
+}
+
+void PluginSlot::setMidiMappings(const String& mappings)
+{
+    int count = 0;
+    for (auto& parameterIndex : controllerMap)
+        parameterIndex = -1;
+
+    // channel:controller=parameter, channels counted from 1
+    for (const auto& mapping : StringArray::fromTokens(mappings, ",", ""))
+    {
+        const int channel = mapping.upToFirstOccurrenceOf(":", false, false).getIntValue();
+        const int controller = mapping.fromFirstOccurrenceOf(":", false, false).upToFirstOccurrenceOf("=", false, false).getIntValue();
+        const int parameterIndex = mapping.fromFirstOccurrenceOf("=", false, false).getIntValue();
+
+        if (channel >= 1 && channel <= 16 && isPositiveAndBelow(controller, 128)
+            && isPositiveAndBelow(parameterIndex, automatable.size()))
+        {
+            controllerMap[static_cast<size_t>((channel - 1) * 128 + controller)] = parameterIndex;
+            count++;
+        }
+    }
+    numMappings = count;
+}
+
+bool PluginSlot::hasDefaultControls() const
+{
+    for (auto* parameter : { inputTrim, outputTrim, mix })
+        if (parameter->getValue() != parameter->getDefaultValue())
+            return false;
+    return true;
+}
+
+String PluginSlot::getControls() const
+{
+    StringArray controls;
+    for (auto* parameter : { inputTrim, outputTrim, mix })
+        controls.add(parameter->getParameterID() + "=" + String(parameter->get()));
+    return controls.joinIntoString(";");
+}
+
+void PluginSlot::setControls(const String& controls)
+{
+    for (auto* parameter : { inputTrim, outputTrim, mix })
+        parameter->setValueNotifyingHost(parameter->getDefaultValue());
+
+    for (const auto& control : StringArray::fromTokens(controls, ";", ""))
+    {
+        const String parameterID = control.upToFirstOccurrenceOf("=", false, false);
+        const float value = control.fromFirstOccurrenceOf("=", false, false).getFloatValue();
+
+        for (auto* parameter : { inputTrim, outputTrim, mix })
+            if (parameter->getParameterID() == parameterID)
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+}
+
+bool PluginSlot::queueParameterChange(int parameterIndex, float value) noexcept
+{
+    if (!isPositiveAndBelow(parameterIndex, automatable.size()))
+        return false;
+
+    const auto scope = parameterFifo.write(1);
+    if (scope.blockSize1 + scope.blockSize2 < 1)
+        return false;
+
+    parameterChanges[static_cast<size_t>(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)]
+        = { parameterIndex, jlimit(0.0f, 1.0f, value) };
+    return true;
+}
+
+void PluginSlot::applyQueuedParameterChanges() noexcept
+{
+    const auto scope = parameterFifo.read(parameterFifo.getNumReady());
+    scope.forEach([&] (int index)
+    {
+        const ParameterChange& change = parameterChanges[static_cast<size_t>(index)];
+        if (auto* parameter = automatable[change.parameterIndex])
+            parameter->setValue(change.value);
+    });
+}
+
+void PluginSlot::applyMidiMappings(const MidiBuffer& midiMessages) noexcept
+{
+    for (const auto metadata : midiMessages)
+    {
+        const uint8* data = metadata.data;
+        if (metadata.numBytes != 3 || (data[0] & 0xf0) != 0xb0)
+            continue;
+
+        auto& parameterIndex = controllerMap[static_cast<size_t>((data[0] & 0x0f) * 128 + data[1])];
+
+        // The first controller moved after a parameter was touched takes it over
+        if (learning.load(std::memory_order_relaxed))
+        {
+            const int touched = lastTouchedParameter.load(std::memory_order_relaxed);
+            if (touched >= 0)
+            {
+                // One controller per parameter, so controllers learned for it before let go of it
+                for (auto& mapped : controllerMap)
+                {
+                    if (&mapped != &parameterIndex && mapped.load(std::memory_order_relaxed) == touched)
+                    {
+                        mapped = -1;
+                        --numMappings;
+                    }
+                }
+
+                if (parameterIndex.exchange(touched) < 0)
+                    ++numMappings;
+                learning = false;
+            }
+        }
+
+        if (auto* parameter = automatable[parameterIndex.load(std::memory_order_relaxed)])
+            parameter->setValue(data[2] / 127.0f);
+    }
+}
+
+void PluginSlot::Meter::add(const AudioBuffer<float>& buffer, int numChannels) noexcept
+{
+    numChannels = jmin(numChannels, buffer.getNumChannels());
+    const int numSamples = buffer.getNumSamples();
+    if (numChannels <= 0 || numSamples <= 0)
+        return;
+
+    float blockPeak = 0.0f;
+    double blockSum = 0.0;
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        float channelPeak, channelSum;
+        SimdKernels::peakAndSumOfSquares(buffer.getReadPointer(channel), numSamples, channelPeak, channelSum);
+        blockPeak = jmax(blockPeak, channelPeak);
+        blockSum += channelSum;
+    }
+
+    // Compare-and-swap rather than a plain store, so a take() in between is never undone
+    float heldPeak = peak.load(std::memory_order_relaxed);
+    while (blockPeak > heldPeak && !peak.compare_exchange_weak(heldPeak, blockPeak, std::memory_order_relaxed)) {}
+
+    double heldSum = sumOfSquares.load(std::memory_order_relaxed);
+    while (!sumOfSquares.compare_exchange_weak(heldSum, heldSum + blockSum, std::memory_order_relaxed)) {}
+
+    numValues.fetch_add(numChannels * numSamples, std::memory_order_relaxed);
+}
+
+PluginSlot::Levels PluginSlot::Meter::take() noexcept
+{
+    Levels levels;
+    levels.peak = peak.exchange(0.0f);
+
+    // The sum and the count are taken one after the other, a block landing in between only skews one reading
+    const double sum = sumOfSquares.exchange(0.0);
+    const int64 count = numValues.exchange(0);
+    if (count > 0)
+        levels.rms = static_cast<float>(std::sqrt(sum / static_cast<double>(count)));
+    return levels;
+}
+
+void PluginSlot::captureDry(const AudioBuffer<float>& buffer, int numChannels, int numSamples) noexcept
+{
+    // Starting from silence beats replaying what was left from the last time the dry path ran
+    if (!dryActive)
+    {
+        dryDelay.clear();
+        dryDelayPosition = 0;
+        dryActive = true;
+    }
+
+    if (dryLatency == 0)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+            dryBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+        return;
+    }
+
+    const int size = dryDelay.getNumSamples();
+    const int readPosition = (dryDelayPosition - dryLatency + size) % size;
+    const int firstWrite = jmin(numSamples, size - dryDelayPosition);
+    const int firstRead = jmin(numSamples, size - readPosition);
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        dryDelay.copyFrom(channel, dryDelayPosition, buffer, channel, 0, firstWrite);
+        if (firstWrite < numSamples)
+            dryDelay.copyFrom(channel, 0, buffer, channel, firstWrite, numSamples - firstWrite);
+
+        dryBuffer.copyFrom(channel, 0, dryDelay, channel, readPosition, firstRead);
+        if (firstRead < numSamples)
+            dryBuffer.copyFrom(channel, firstRead, dryDelay, channel, 0, numSamples - firstRead);
+    }
+
+    dryDelayPosition = (dryDelayPosition + numSamples) % size;
+}
+
+void PluginSlot::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    const TraceScope trace("processBlock", traceId);
+
+    // Only ever contended by a latency change swapping in a new dry delay
+    const ScopedLock sl(getCallbackLock());
+
+    if (parameterFifo.getNumReady() > 0)
+        applyQueuedParameterChanges();
+
+    if (numMappings.load(std::memory_order_relaxed) > 0 || learning.load(std::memory_order_relaxed))
+        applyMidiMappings(midiMessages);
+
+    const int numSamples = buffer.getNumSamples();
+    const int numInputs = jmin(getTotalNumInputChannels(), buffer.getNumChannels());
+    const int numOutputs = jmin(getTotalNumOutputChannels(), buffer.getNumChannels());
+
+    // Everything below works in place on the graph's buffer
+    inputGain.setTargetValue(Decibels::decibelsToGain(inputTrim->get()));
+    if (inputGain.isSmoothing() || inputGain.getTargetValue() != 1.0f)
+    {
+        const float start = inputGain.getCurrentValue();
+        const float end = inputGain.skip(numSamples);
+        for (int channel = 0; channel < numInputs; channel++)
+            SimdKernels::multiplyByRamp(buffer.getWritePointer(channel), numSamples, start, end);
+    }
+
+    const bool metering = chainMetering != nullptr && chainMetering->load(std::memory_order_relaxed);
+    int64 start = 0;
+    if (metering)
+    {
+        start = Time::getHighResolutionTicks();
+        inputMeter.add(buffer, getTotalNumInputChannels());
+        meteringTicks.fetch_add(Time::getHighResolutionTicks() - start, std::memory_order_relaxed);
+    }
+
+    // Parameters move at block rate, before the plugin sees the block
+    modulation.process(automatable, buffer, numInputs, numSamples,
+                       chainInputLevel != nullptr ? chainInputLevel->load(std::memory_order_relaxed) : -1.0f);
+
+    // The dry path only runs while some of it is audible
+    wetAmount.setTargetValue(mix->get() / 100.0f);
+    const int numDryChannels = jmin(numInputs, dryBuffer.getNumChannels());
+    const bool mixing = numDryChannels > 0 && numSamples <= dryBuffer.getNumSamples()
+                        && (wetAmount.isSmoothing() || wetAmount.getTargetValue() < 1.0f);
+    if (mixing)
+        captureDry(buffer, numDryChannels, numSamples);
+    else
+        dryActive = false;
+
+    plugin->processBlock(buffer, midiMessages);
+
+    outputGain.setTargetValue(Decibels::decibelsToGain(outputTrim->get()));
+    const float outputStart = outputGain.getCurrentValue();
+    const float outputEnd = outputGain.skip(numSamples);
+
+    if (mixing)
+    {
+        const float wetStart = wetAmount.getCurrentValue();
+        const float wetEnd = wetAmount.skip(numSamples);
+        for (int channel = 0; channel < numOutputs; channel++)
+            SimdKernels::mixWithRamps(buffer.getWritePointer(channel), dryBuffer.getReadPointer(jmin(channel, numDryChannels - 1)), numSamples,
+                                      outputStart * wetStart, outputEnd * wetEnd,
+                                      outputStart * (1.0f - wetStart), outputEnd * (1.0f - wetEnd));
+    }
+    else
+    {
+        wetAmount.skip(numSamples);
+        if (outputStart != 1.0f || outputEnd != 1.0f)
+            for (int channel = 0; channel < numOutputs; channel++)
+                SimdKernels::multiplyByRamp(buffer.getWritePointer(channel), numSamples, outputStart, outputEnd);
+    }
+
+    if (metering)
+    {
+        start = Time::getHighResolutionTicks();
+        outputMeter.add(buffer, getTotalNumOutputChannels());
+        meteringTicks.fetch_add(Time::getHighResolutionTicks() - start, std::memory_order_relaxed);
+    }
+}
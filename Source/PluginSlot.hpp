@@ -0,0 +1,170 @@
+//
+//  PluginSlot.hpp
+//  SoftHost
+//
+//  Graph node that owns one hosted plugin and forwards everything to it. It
+//  gives the host a place to do its own per-node work around the plugin's
+//  processBlock without the plugin knowing, such as mapping MIDI controllers
+//  to plugin parameters and metering what goes in and comes out. Its own
+//  parameters trim the plugin's input and output and blend the plugin with
+//  a dry path delayed by the plugin's latency, for plugins without a mix
+//  control. Host-side modulators and parameter changes queued from other
+//  threads move the plugin's parameters right before each block. MIDI
+//  learn, modulators and queued changes address the plugin's parameters
+//  first and the slot's own three after them, so those are automatable too.
+//
+
+#ifndef PluginSlot_hpp
+#define PluginSlot_hpp
+
+#include "LoadCost.hpp"
+#include "ModulationEngine.hpp"
+
+class PluginSlot : public AudioProcessor, private AudioProcessorListener, private AsyncUpdater
+{
+public:
+    explicit PluginSlot(std::unique_ptr<AudioPluginInstance> plugin);
+    ~PluginSlot() override;
+
+    AudioPluginInstance& getPlugin() noexcept { return *plugin; }
+
+    // The plugin's parameters followed by the slot's trims and mix, the indexes automation uses
+    const Array<AudioProcessorParameter*>& getAutomatableParameters() const noexcept { return automatable; }
+    static AudioPluginInstance* getPluginFor(AudioProcessor* processor);
+    int64 getTraceId() const noexcept { return traceId; }
+
+    // VST3 wants setActive() from the thread that created the plugin, others can be prepared side by side
+    bool canPrepareConcurrently() const;
+
+    // MIDI learn: arm it, touch a control in the plugin editor, then move a controller
+    void setLearning(bool shouldLearn) noexcept;
+    bool isLearning() const noexcept { return learning; }
+    bool hasMidiMappings() const noexcept { return numMappings > 0; }
+    String getMidiMappings() const;
+    void setMidiMappings(const String& mappings);
+
+    // Levels since the previous take, for meters polled on the message thread
+    struct Levels
+    {
+        float peak = 0.0f, rms = 0.0f;
+    };
+
+    // The chain's flag, set while its meter window is open. Meters cost nothing otherwise
+    void setMeteringFlag(const std::atomic<bool>* flag) noexcept { chainMetering = flag; }
+    Levels takeInputLevels() noexcept { return inputMeter.take(); }
+    Levels takeOutputLevels() noexcept { return outputMeter.take(); }
+    int64 takeMeteringTicks() noexcept { return meteringTicks.exchange(0); }
+
+    // Trims in dB and the wet share in percent, saved as "inputTrim=0;outputTrim=0;mix=100"
+    bool hasDefaultControls() const;
+    String getControls() const;
+    void setControls(const String& controls);
+
+    // From one thread at a time, applied by the audio thread at the start of the next block
+    bool queueParameterChange(int parameterIndex, float value) noexcept;
+
+    ModulationEngine& getModulation() noexcept { return modulation; }
+    void setChainInputLevel(const std::atomic<float>* level) noexcept { chainInputLevel = level; }
+
+    // Called on the message thread once the slot has taken on a new latency from its plugin, to rebuild the graph
+    std::function<void()> onLatencyChanged;
+
+    // Filled in by PluginChain when the instance is created, see LoadCost
+    const LoadCost& getLoadCost() const noexcept { return loadCost; }
+    void setLoadCost(const LoadCost& cost) noexcept { loadCost = cost; }
+
+    const String getName() const override { return plugin->getName(); }
+    bool isBusesLayoutSupported(const BusesLayout& layouts) const override { return plugin->checkBusesLayoutSupported(layouts); }
+
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+    void reset() override { plugin->reset(); }
+    void setNonRealtime(bool isNonRealtime) noexcept override;
+    void setPlayHead(AudioPlayHead* newPlayHead) override { AudioProcessor::setPlayHead(newPlayHead); plugin->setPlayHead(newPlayHead); }
+
+    double getTailLengthSeconds() const override { return plugin->getTailLengthSeconds(); }
+    // Always true so learned controllers reach effects too, the plugin decides what to do with the rest
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return plugin->producesMidi(); }
+    bool isMidiEffect() const override { return plugin->isMidiEffect(); }
+
+    // Editors are created on the plugin itself, see getPluginFor()
+    AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return plugin->getNumPrograms(); }
+    int getCurrentProgram() override { return plugin->getCurrentProgram(); }
+    void setCurrentProgram(int index) override { plugin->setCurrentProgram(index); }
+    const String getProgramName(int index) override { return plugin->getProgramName(index); }
+    void changeProgramName(int index, const String& newName) override { plugin->changeProgramName(index, newName); }
+
+    void getStateInformation(MemoryBlock& destData) override { plugin->getStateInformation(destData); }
+    void setStateInformation(const void* data, int sizeInBytes) override { plugin->setStateInformation(data, sizeInBytes); }
+
+private:
+    static BusesProperties getBusesPropertiesFor(AudioPluginInstance& plugin);
+    void applyMidiMappings(const MidiBuffer& midiMessages) noexcept;
+    void applyQueuedParameterChanges() noexcept;
+    void captureDry(const AudioBuffer<float>& buffer, int numChannels, int numSamples) noexcept;
+    // Only a gesture means the user grabbed the control, plugins also change parameters on their own
+    void audioProcessorParameterChanged(AudioProcessor*, int, float) override {}
+    void audioProcessorParameterChangeGestureBegin(AudioProcessor* processor, int parameterIndex) override;
+    void audioProcessorChanged(AudioProcessor*, const ChangeDetails& details) override;
+    void handleAsyncUpdate() override;
+
+    // Written by the audio thread only, the reader resets each value as it takes it
+    struct Meter
+    {
+        void add(const AudioBuffer<float>& buffer, int numChannels) noexcept;
+        Levels take() noexcept;
+
+        std::atomic<float> peak { 0.0f };
+        std::atomic<double> sumOfSquares { 0.0 };
+        std::atomic<int64> numValues { 0 };
+    };
+
+    std::unique_ptr<AudioPluginInstance> plugin;
+    const int64 traceId;
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+
+    // Parameter index per MIDI channel and controller number, -1 when unmapped
+    std::array<std::atomic<int>, 16 * 128> controllerMap;
+    std::atomic<int> numMappings { 0 }, lastTouchedParameter { -1 };
+    std::atomic<bool> learning { false };
+
+    Meter inputMeter, outputMeter;
+    std::atomic<int64> meteringTicks { 0 };
+
+    // Owned by the AudioProcessor base class
+    AudioParameterFloat* inputTrim;
+    AudioParameterFloat* outputTrim;
+    AudioParameterFloat* mix;
+    SmoothedValue<float> inputGain, outputGain, wetAmount;
+    Array<AudioProcessorParameter*> automatable;
+
+    // Preallocated in prepareToPlay() and swapped under the callback lock when the latency changes,
+    // the delay holds the plugin's latency plus one block
+    AudioBuffer<float> dryBuffer, dryDelay;
+    int dryLatency = 0, dryDelayPosition = 0;
+    bool dryActive = false;
+
+    struct ParameterChange
+    {
+        int parameterIndex;
+        float value;
+    };
+
+    std::array<ParameterChange, 256> parameterChanges;
+    AbstractFifo parameterFifo { 256 };
+
+    ModulationEngine modulation;
+    const std::atomic<float>* chainInputLevel = nullptr;
+    const std::atomic<bool>* chainMetering = nullptr;
+    LoadCost loadCost;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginSlot)
+};
+
+#endif /* PluginSlot_hpp */
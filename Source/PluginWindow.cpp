@@ -1,217 +1,436 @@
-#include "../JuceLibraryCode/JuceHeader.h"
-#include "PluginWindow.hpp"
-
-class PluginWindow;
-static Array<PluginWindow*> activePluginWindows;
-static CriticalSection activeWindowsLock;
-
-PluginWindow::PluginWindow(Component* const pluginEditor,
-                         AudioProcessorGraph::Node::Ptr node,
-                         WindowFormatType t)
-    : DocumentWindow(pluginEditor->getName(), Colours::lightgrey,
-                     DocumentWindow::minimiseButton | DocumentWindow::closeButton),
-      owner(std::move(node)),
-      type(t)
-{
-    setSize(400, 300);
-    setUsingNativeTitleBar(true);
-    setContentOwned(pluginEditor, true);
-
-    const int defaultX = Random::getSystemRandom().nextInt(500);
-    const int defaultY = Random::getSystemRandom().nextInt(500);
-    
-    setTopLeftPosition(owner->properties.getWithDefault(getLastXProp(type), defaultX),
-                      owner->properties.getWithDefault(getLastYProp(type), defaultY));
-
-    owner->properties.set(getOpenProp(type), true);
-
-    setVisible(true);
-
-    const ScopedLock sl(activeWindowsLock);
-    activePluginWindows.add(this);
-}
-
-void PluginWindow::closeCurrentlyOpenWindowsFor(const AudioProcessorGraph::NodeID nodeId)
-{
-    const ScopedLock sl(activeWindowsLock);
-    
-    for (int i = activePluginWindows.size(); --i >= 0;)
-    {
-        if (activePluginWindows.getUnchecked(i)->owner->nodeID == nodeId)
-        {
-            delete activePluginWindows.getUnchecked(i);
-            // Deletion will automatically remove from array via destructor
-        }
-    }
-}
-
-void PluginWindow::closeAllCurrentlyOpenWindows()
-{
-    {
-        const ScopedLock sl(activeWindowsLock);
-        
-        if (activePluginWindows.size() > 0)
-        {
-            for (int i = activePluginWindows.size(); --i >= 0;)
-                delete activePluginWindows.getUnchecked(i);
-        }
-    }
-
-    // Give windows a chance to close properly
-    Component dummyModalComp;
-    dummyModalComp.enterModalState();
-    // Replace deprecated runDispatchLoopUntil with this:
-    MessageManager::getInstance()->runDispatchLoop();
-}
-
-bool PluginWindow::containsActiveWindows()
-{
-    const ScopedLock sl(activeWindowsLock);
-    return !activePluginWindows.isEmpty();
-}
-
-//==============================================================================
-class ProcessorProgramPropertyComp : public PropertyComponent,
-                                   private AudioProcessorListener
-{
-public:
-    ProcessorProgramPropertyComp(const String& name, AudioProcessor& p, int index_)
-        : PropertyComponent(name),
-          owner(p),
-          index(index_)
-    {
-        owner.addListener(this);
-    }
-
-    ~ProcessorProgramPropertyComp() override
-    {
-        owner.removeListener(this);
-    }
-
-    void refresh() override {}
-    
-    // Updated to match new signature
-    void audioProcessorChanged(AudioProcessor*, const AudioProcessorListener::ChangeDetails&) override {}
-    void audioProcessorParameterChanged(AudioProcessor*, int, float) override {}
-
-private:
-    AudioProcessor& owner;
-    const int index;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorProgramPropertyComp)
-};
-
-class ProgramAudioProcessorEditor : public AudioProcessorEditor
-{
-public:
-    explicit ProgramAudioProcessorEditor(AudioProcessor* const p)
-        : AudioProcessorEditor(*p)  // Updated to use reference instead of pointer
-    {
-        jassert(p != nullptr);
-        setOpaque(true);
-
-        addAndMakeVisible(panel);
-
-        Array<PropertyComponent*> programs;
-
-        const int numPrograms = p->getNumPrograms();
-        int totalHeight = 0;
-
-        for (int i = 0; i < numPrograms; ++i)
-        {
-            String name(p->getProgramName(i).trim());
-
-            if (name.isEmpty())
-                name = "Unnamed";
-
-            auto* pc = new ProcessorProgramPropertyComp(name, *p, i);
-            programs.add(pc);
-            totalHeight += pc->getPreferredHeight();
-        }
-
-        panel.addProperties(programs);
-
-        setSize(400, jlimit(25, 400, totalHeight));
-    }
-
-    void paint(Graphics& g) override
-    {
-        g.fillAll(Colours::grey);
-    }
-
-    void resized() override
-    {
-        panel.setBounds(getLocalBounds());
-    }
-
-private:
-    PropertyPanel panel;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramAudioProcessorEditor)
-};
-
-//==============================================================================
-std::unique_ptr<PluginWindow> PluginWindow::getWindowFor(AudioProcessorGraph::Node::Ptr node,
-                                      WindowFormatType type)
-{
-    jassert(node != nullptr);
-
-    {
-        const ScopedLock sl(activeWindowsLock);
-        
-        for (auto* window : activePluginWindows)
-            if (window->owner == node && window->type == type)
-                return nullptr; // Window already exists
-    }
-
-    AudioProcessor* processor = node->getProcessor();
-    if (processor == nullptr)
-        return nullptr;
-
-    std::unique_ptr<AudioProcessorEditor> ui;
-
-    if (type == Normal)
-    {
-        ui.reset(processor->createEditorIfNeeded());
-
-        if (ui == nullptr)
-            type = Generic;
-    }
-
-    if (ui == nullptr)
-    {
-        if (type == Generic || type == Parameters)
-            ui.reset(new GenericAudioProcessorEditor(*processor));  // Use reference
-        else if (type == Programs)
-            ui.reset(new ProgramAudioProcessorEditor(processor));
-    }
-
-    if (ui != nullptr)
-    {
-        if (auto* plugin = dynamic_cast<AudioPluginInstance*>(processor))
-            ui->setName(plugin->getName());
-
-        return std::make_unique<PluginWindow>(ui.release(), node, type);
-    }
-
-    return nullptr;
-}
-
-PluginWindow::~PluginWindow()
-{
-    const ScopedLock sl(activeWindowsLock);
-    activePluginWindows.removeFirstMatchingValue(this);
-    clearContentComponent();
-}
-
-void PluginWindow::moved()
-{
-    owner->properties.set(getLastXProp(type), getX());
-    owner->properties.set(getLastYProp(type), getY());
-}
-
-void PluginWindow::closeButtonPressed()
-{
-    owner->properties.set(getOpenProp(type), false);
-    delete this;
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginWindow.hpp"
+#include "PluginSlot.hpp"
+#include "Tracer.hpp"
+
+class PluginWindow;
+static Array<PluginWindow*> activePluginWindows;
+static CriticalSection activeWindowsLock;
+
+PluginWindow::PluginWindow(Component* const pluginEditor,
+                         AudioProcessorGraph::Node::Ptr node,
+                         WindowFormatType t)
+    : DocumentWindow(pluginEditor->getName(), Colours::lightgrey,
+                     DocumentWindow::minimiseButton | DocumentWindow::closeButton),
+      owner(std::move(node)),
+      type(t)
+{
+    setSize(400, 300);
+    setUsingNativeTitleBar(true);
+    setContentOwned(pluginEditor, true);
+
+    const int defaultX = Random::getSystemRandom().nextInt(500);
+    const int defaultY = Random::getSystemRandom().nextInt(500);
+    
+    setTopLeftPosition(owner->properties.getWithDefault(getLastXProp(type), defaultX),
+                      owner->properties.getWithDefault(getLastYProp(type), defaultY));
+
+    owner->properties.set(getOpenProp(type), true);
+
+    setVisible(true);
+
+    const ScopedLock sl(activeWindowsLock);
+    activePluginWindows.add(this);
+}
+
+void PluginWindow::closeCurrentlyOpenWindowsFor(const AudioProcessorGraph::Node* node)
+{
+    const ScopedLock sl(activeWindowsLock);
+    
+    // Node ids are only unique within one graph, every chain and scene has its own
+    for (int i = activePluginWindows.size(); --i >= 0;)
+    {
+        if (activePluginWindows.getUnchecked(i)->owner.get() == node)
+        {
+            delete activePluginWindows.getUnchecked(i);
+            // Deletion will automatically remove from array via destructor
+        }
+    }
+}
+
+void PluginWindow::closeAllCurrentlyOpenWindows()
+{
+    const ScopedLock sl(activeWindowsLock);
+
+    for (int i = activePluginWindows.size(); --i >= 0;)
+        delete activePluginWindows.getUnchecked(i);
+}
+
+bool PluginWindow::containsActiveWindows()
+{
+    const ScopedLock sl(activeWindowsLock);
+    return !activePluginWindows.isEmpty();
+}
+
+//==============================================================================
+class ProcessorProgramPropertyComp : public PropertyComponent,
+                                   private AudioProcessorListener
+{
+public:
+    ProcessorProgramPropertyComp(const String& name, AudioProcessor& p, int index_)
+        : PropertyComponent(name),
+          owner(p),
+          index(index_)
+    {
+        owner.addListener(this);
+    }
+
+    ~ProcessorProgramPropertyComp() override
+    {
+        owner.removeListener(this);
+    }
+
+    void refresh() override {}
+    
+    // Updated to match new signature
+    void audioProcessorChanged(AudioProcessor*, const AudioProcessorListener::ChangeDetails&) override {}
+    void audioProcessorParameterChanged(AudioProcessor*, int, float) override {}
+
+private:
+    AudioProcessor& owner;
+    const int index;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorProgramPropertyComp)
+};
+
+class ProgramAudioProcessorEditor : public AudioProcessorEditor
+{
+public:
+    explicit ProgramAudioProcessorEditor(AudioProcessor* const p)
+        : AudioProcessorEditor(*p)  // Updated to use reference instead of pointer
+    {
+        jassert(p != nullptr);
+        setOpaque(true);
+
+        addAndMakeVisible(panel);
+
+        Array<PropertyComponent*> programs;
+
+        const int numPrograms = p->getNumPrograms();
+        int totalHeight = 0;
+
+        for (int i = 0; i < numPrograms; ++i)
+        {
+            String name(p->getProgramName(i).trim());
+
+            if (name.isEmpty())
+                name = "Unnamed";
+
+            auto* pc = new ProcessorProgramPropertyComp(name, *p, i);
+            programs.add(pc);
+            totalHeight += pc->getPreferredHeight();
+        }
+
+        panel.addProperties(programs);
+
+        setSize(400, jlimit(25, 400, totalHeight));
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.fillAll(Colours::grey);
+    }
+
+    void resized() override
+    {
+        panel.setBounds(getLocalBounds());
+    }
+
+private:
+    PropertyPanel panel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProgramAudioProcessorEditor)
+};
+
+//==============================================================================
+// One row per modulator: what it is, the parameter it moves, and how far and how fast
+class ModulatorRow : public Component
+{
+public:
+    ModulatorRow(const Array<AudioProcessorParameter*>& parameters, const ModulationEngine::Modulator& modulator,
+                 std::function<void()> onChange_)
+        : onChange(std::move(onChange_))
+    {
+        type.addItemList({ "Off", "LFO", "Envelope", "Steps" }, 1);
+        type.setSelectedId(modulator.type + 1, dontSendNotification);
+
+        for (int i = 0; i < parameters.size(); i++)
+            parameter.addItem(parameters.getUnchecked(i)->getName(40), i + 1);
+        parameter.setSelectedId(modulator.parameterIndex + 1, dontSendNotification);
+        parameter.setTextWhenNothingSelected("Parameter");
+
+        shape.addItemList({ "Sine", "Triangle", "Square", "Saw" }, 1);
+        shape.setSelectedId(modulator.shape + 1, dontSendNotification);
+
+        base.setRange(0.0, 1.0, 0.001);
+        base.setValue(modulator.base, dontSendNotification);
+        base.setTooltip("Parameter value the modulator moves around");
+        depth.setRange(-1.0, 1.0, 0.001);
+        depth.setValue(modulator.depth, dontSendNotification);
+        depth.setTooltip("How far the modulator moves the parameter, negative values invert it");
+        rate.setRange(0.01, 50.0, 0.01);
+        rate.setSkewFactorFromMidPoint(1.0);
+        rate.setValue(modulator.rate, dontSendNotification);
+
+        StringArray values;
+        for (int i = 0; i < modulator.numSteps; i++)
+            values.add(String(modulator.steps[static_cast<size_t>(i)], 2));
+        steps.setText(values.joinIntoString(" "), false);
+        steps.setTooltip("Up to " + String(ModulationEngine::maxSteps) + " values from 0 to 1, separated by spaces");
+
+        for (auto* slider : { &base, &depth, &rate })
+        {
+            slider->setSliderStyle(Slider::LinearHorizontal);
+            slider->setTextBoxStyle(Slider::TextBoxRight, false, 45, 20);
+            slider->onValueChange = [this] { onChange(); };
+        }
+        for (auto* box : { &type, &parameter, &shape })
+            box->onChange = [this] { updateVisibility(); onChange(); };
+        steps.onTextChange = [this] { onChange(); };
+
+        for (auto* component : std::initializer_list<Component*> { &type, &parameter, &base, &depth, &rate, &shape, &steps })
+            addAndMakeVisible(component);
+        updateVisibility();
+    }
+
+    ModulationEngine::Modulator getModulator() const
+    {
+        ModulationEngine::Modulator modulator;
+        modulator.type = static_cast<ModulationEngine::Type>(jmax(0, type.getSelectedId() - 1));
+        modulator.parameterIndex = parameter.getSelectedId() - 1;
+        modulator.base = static_cast<float>(base.getValue());
+        modulator.depth = static_cast<float>(depth.getValue());
+        modulator.rate = static_cast<float>(rate.getValue());
+        modulator.shape = static_cast<ModulationEngine::Shape>(jmax(0, shape.getSelectedId() - 1));
+
+        for (const auto& value : StringArray::fromTokens(steps.getText(), " ,", ""))
+            if (value.isNotEmpty() && modulator.numSteps < ModulationEngine::maxSteps)
+                modulator.steps[static_cast<size_t>(modulator.numSteps++)] = jlimit(0.0f, 1.0f, value.getFloatValue());
+
+        return modulator;
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced(2);
+        type.setBounds(area.removeFromLeft(90));
+        parameter.setBounds(area.removeFromLeft(160).withTrimmedLeft(4));
+        base.setBounds(area.removeFromLeft(130).withTrimmedLeft(4));
+        depth.setBounds(area.removeFromLeft(130).withTrimmedLeft(4));
+        rate.setBounds(area.removeFromLeft(130).withTrimmedLeft(4));
+        shape.setBounds(area.withTrimmedLeft(4));
+        steps.setBounds(area.withTrimmedLeft(4));
+    }
+
+private:
+    void updateVisibility()
+    {
+        const int selected = type.getSelectedId() - 1;
+        shape.setVisible(selected == ModulationEngine::LFO);
+        steps.setVisible(selected == ModulationEngine::StepSequencer);
+        rate.setTextValueSuffix(selected == ModulationEngine::LFO ? " Hz" : selected == ModulationEngine::StepSequencer ? " /s" : " rel");
+        rate.setTooltip(selected == ModulationEngine::EnvelopeFollower ? "How fast the envelope falls back, the time it takes is one over this"
+                                                                       : "Cycles or steps per second");
+        for (auto* component : std::initializer_list<Component*> { &parameter, &base, &depth, &rate })
+            component->setEnabled(selected != ModulationEngine::Off);
+    }
+
+    std::function<void()> onChange;
+    ComboBox type, parameter, shape;
+    Slider base, depth, rate;
+    TextEditor steps;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulatorRow)
+};
+
+// Edits the slot's modulators, every change is handed to the audio thread as a whole
+class ModulationEditor : public AudioProcessorEditor
+{
+public:
+    explicit ModulationEditor(PluginSlot& slot_)
+        : AudioProcessorEditor(slot_),
+          slot(slot_)
+    {
+        const ModulationEngine::Config& config = slot.getModulation().getConfig();
+        for (const auto& modulator : config.modulators)
+            addAndMakeVisible(rows.add(new ModulatorRow(slot.getAutomatableParameters(), modulator, [this] { publish(); })));
+
+        setSize(820, headerHeight + rowHeight * rows.size());
+    }
+
+    void paint(Graphics& g) override
+    {
+        g.fillAll(Colours::lightgrey);
+        g.setColour(Colours::black);
+        g.setFont(13.0f);
+
+        int x = 2;
+        for (const auto& column : { std::make_pair("Modulator", 90), std::make_pair("Parameter", 160), std::make_pair("Base", 130),
+                                    std::make_pair("Depth", 130), std::make_pair("Rate", 130), std::make_pair("Shape / Steps", 160) })
+        {
+            g.drawText(column.first, x + 4, 0, column.second - 4, headerHeight, Justification::centredLeft);
+            x += column.second;
+        }
+    }
+
+    void resized() override
+    {
+        for (int i = 0; i < rows.size(); i++)
+            rows.getUnchecked(i)->setBounds(0, headerHeight + i * rowHeight, getWidth(), rowHeight);
+    }
+
+private:
+    void publish()
+    {
+        ModulationEngine::Config config;
+        for (int i = 0; i < rows.size(); i++)
+            config.modulators[static_cast<size_t>(i)] = rows.getUnchecked(i)->getModulator();
+        slot.getModulation().setConfig(config);
+    }
+
+    static const int headerHeight = 22, rowHeight = 28;
+    PluginSlot& slot;
+    OwnedArray<ModulatorRow> rows;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulationEditor)
+};
+
+//==============================================================================
+AudioProcessorEditor* PluginWindow::createEditorFor(AudioProcessorGraph::Node::Ptr node, WindowFormatType& type)
+{
+    // The host's trims and mix are parameters of the slot, not of the plugin
+    if (type == SlotControls)
+    {
+        auto* slot = dynamic_cast<PluginSlot*>(node->getProcessor());
+        if (slot == nullptr)
+            return nullptr;
+
+        auto* ui = new GenericAudioProcessorEditor(*slot);
+        ui->setName(slot->getName() + " - Mix and Trim");
+        return ui;
+    }
+
+    if (type == Modulation)
+    {
+        auto* slot = dynamic_cast<PluginSlot*>(node->getProcessor());
+        if (slot == nullptr)
+            return nullptr;
+
+        auto* ui = new ModulationEditor(*slot);
+        ui->setName(slot->getName() + " - Modulation");
+        return ui;
+    }
+
+    AudioProcessor* processor = PluginSlot::getPluginFor(node->getProcessor());
+    if (processor == nullptr)
+        return nullptr;
+
+    const TraceScope trace("Create Editor");
+    std::unique_ptr<AudioProcessorEditor> ui;
+
+    if (type == Normal)
+    {
+        ui.reset(processor->createEditorIfNeeded());
+
+        if (ui == nullptr)
+            type = Generic;
+    }
+
+    if (ui == nullptr)
+    {
+        if (type == Generic || type == Parameters)
+            ui.reset(new GenericAudioProcessorEditor(*processor));  // Use reference
+        else if (type == Programs)
+            ui.reset(new ProgramAudioProcessorEditor(processor));
+    }
+
+    if (ui != nullptr)
+        if (auto* plugin = dynamic_cast<AudioPluginInstance*>(processor))
+            ui->setName(plugin->getName());
+
+    return ui.release();
+}
+
+PluginWindow* PluginWindow::getWindowFor(AudioProcessorGraph::Node::Ptr node,
+                                         WindowFormatType type)
+{
+    jassert(node != nullptr);
+
+    {
+        const ScopedLock sl(activeWindowsLock);
+
+        for (auto* window : activePluginWindows)
+        {
+            if (window->owner == node && window->type == type)
+            {
+                if (window->isMinimised())
+                    window->setMinimised(false);
+                return window;
+            }
+        }
+    }
+
+    const TraceScope trace("Open Plugin Window");
+
+    if (auto* ui = createEditorFor(node, type))
+        return new PluginWindow(ui, node, type);
+
+    return nullptr;
+}
+
+PluginWindow::~PluginWindow()
+{
+    const TraceScope trace("Close Plugin Window");
+    const ScopedLock sl(activeWindowsLock);
+    activePluginWindows.removeFirstMatchingValue(this);
+    clearContentComponent();
+}
+
+void PluginWindow::moved()
+{
+    owner->properties.set(getLastXProp(type), getX());
+    owner->properties.set(getLastYProp(type), getY());
+}
+
+void PluginWindow::closeButtonPressed()
+{
+    owner->properties.set(getOpenProp(type), false);
+    setVisible(false);
+
+    // Deleted once this callback has returned rather than from inside it
+    Component::SafePointer<PluginWindow> window(this);
+    MessageManager::callAsync([window]
+    {
+        if (window != nullptr)
+            delete window.getComponent();
+    });
+}
+
+void PluginWindow::minimisationStateChanged(bool isNowMinimised)
+{
+    stopTimer();
+
+    auto* settings = getAppProperties().getUserSettings();
+    if (isNowMinimised && settings->getBoolValue(getUnloadEditorsProp(), false))
+    {
+        startTimer(1000 * jmax(1, settings->getIntValue(getUnloadEditorsDelayProp(), 30)));
+    }
+    else if (!isNowMinimised && getContentComponent() == nullptr)
+    {
+        if (auto* ui = createEditorFor(owner, type))
+            setContentOwned(ui, true);
+    }
+}
+
+void PluginWindow::timerCallback()
+{
+    stopTimer();
+
+    // Releases the editor's GPU and bitmap resources while nobody can see it
+    if (isMinimised() && getContentComponent() != nullptr)
+    {
+        auto* slot = dynamic_cast<PluginSlot*>(owner->getProcessor());
+        Tracer::instant("Unload Editor", slot != nullptr ? slot->getTraceId() : -1);
+        clearContentComponent();
+    }
 }
\ No newline at end of file
@@ -1,55 +1,68 @@
-#ifndef PluginWindow_hpp
-#define PluginWindow_hpp
-
-ApplicationProperties& getAppProperties();
-
-class PluginWindow : public DocumentWindow
-{
-public:
-    enum WindowFormatType
-    {
-        Normal = 0,
-        Generic,
-        Programs,
-        Parameters,
-        NumTypes
-    };
-
-    PluginWindow(Component* pluginEditor, AudioProcessorGraph::Node::Ptr node, WindowFormatType type);
-    ~PluginWindow() override;
-
-    static std::unique_ptr<PluginWindow> getWindowFor(AudioProcessorGraph::Node::Ptr node, WindowFormatType type);
-
-    static void closeCurrentlyOpenWindowsFor(const AudioProcessorGraph::NodeID nodeId);
-    static void closeAllCurrentlyOpenWindows();
-    static bool containsActiveWindows();
-
-    void moved() override;
-    void closeButtonPressed() override;
-
-private:
-    AudioProcessorGraph::Node::Ptr owner;
-    WindowFormatType type;
-
-    float getDesktopScaleFactor() const override { return 1.0f; }
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginWindow)
-};
-
-inline String toString(PluginWindow::WindowFormatType type)
-{
-    switch (type)
-    {
-        case PluginWindow::Normal:     return "Normal";
-        case PluginWindow::Generic:    return "Generic";
-        case PluginWindow::Programs:   return "Programs";
-        case PluginWindow::Parameters: return "Parameters";
-        default:                       return String();
-    }
-}
-
-inline String getLastXProp(PluginWindow::WindowFormatType type) { return "uiLastX_" + toString(type); }
-inline String getLastYProp(PluginWindow::WindowFormatType type) { return "uiLastY_" + toString(type); }
-inline String getOpenProp(PluginWindow::WindowFormatType type)  { return "uiopen_"  + toString(type); }
-
+#ifndef PluginWindow_hpp
+#define PluginWindow_hpp
+
+ApplicationProperties& getAppProperties();
+
+class PluginWindow : public DocumentWindow, private Timer
+{
+public:
+    enum WindowFormatType
+    {
+        Normal = 0,
+        Generic,
+        Programs,
+        Parameters,
+        SlotControls,
+        Modulation,
+        NumTypes
+    };
+
+    PluginWindow(Component* pluginEditor, AudioProcessorGraph::Node::Ptr node, WindowFormatType type);
+    ~PluginWindow() override;
+
+    // Windows own themselves and stay in the open window list until they are closed
+    static PluginWindow* getWindowFor(AudioProcessorGraph::Node::Ptr node, WindowFormatType type);
+
+    static void closeCurrentlyOpenWindowsFor(const AudioProcessorGraph::Node* node);
+    static void closeAllCurrentlyOpenWindows();
+    static bool containsActiveWindows();
+
+    void moved() override;
+    void closeButtonPressed() override;
+    void minimisationStateChanged(bool isNowMinimised) override;
+
+private:
+    static AudioProcessorEditor* createEditorFor(AudioProcessorGraph::Node::Ptr node, WindowFormatType& type);
+    void timerCallback() override;
+
+    AudioProcessorGraph::Node::Ptr owner;
+    WindowFormatType type;
+
+    float getDesktopScaleFactor() const override { return 1.0f; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginWindow)
+};
+
+inline String toString(PluginWindow::WindowFormatType type)
+{
+    switch (type)
+    {
+        case PluginWindow::Normal:       return "Normal";
+        case PluginWindow::Generic:      return "Generic";
+        case PluginWindow::Programs:     return "Programs";
+        case PluginWindow::Parameters:   return "Parameters";
+        case PluginWindow::SlotControls: return "SlotControls";
+        case PluginWindow::Modulation:   return "Modulation";
+        default:                         return String();
+    }
+}
+
+inline String getLastXProp(PluginWindow::WindowFormatType type) { return "uiLastX_" + toString(type); }
+inline String getLastYProp(PluginWindow::WindowFormatType type) { return "uiLastY_" + toString(type); }
+inline String getOpenProp(PluginWindow::WindowFormatType type)  { return "uiopen_"  + toString(type); }
+
+// Editors of windows minimised for longer than this are destroyed and recreated on restore
+inline String getUnloadEditorsProp()      { return "unloadMinimisedEditors"; }
+inline String getUnloadEditorsDelayProp() { return "unloadMinimisedEditorsDelay"; }
+
 #endif /* PluginWindow_hpp */
\ No newline at end of file
@@ -0,0 +1,173 @@
+//
+//  RealtimePolicy.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimePolicy.hpp"
+
+#if JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    enum MemoryLock
+    {
+        NoLock = 0,
+        LockCurrent,
+        LockCurrentAndFuture
+    };
+
+    struct ThreadPolicy
+    {
+        int priority = 0;
+        bool pinned = false;
+       #if JUCE_LINUX
+        cpu_set_t cpus;
+       #endif
+
+        // Error numbers left by the threads, turned into messages on the message thread
+        std::atomic<int> schedulingError { 0 }, affinityError { 0 };
+    };
+
+    ThreadPolicy audioPolicy, workerPolicy;
+    MemoryLock memoryLock = NoLock;
+    std::atomic<bool> configured { false };
+    StringArray problems;
+
+    void parsePolicy(PropertiesFile& settings, const String& name, const String& priorityKey, const String& affinityKey,
+                     ThreadPolicy& policy)
+    {
+        policy.priority = settings.getIntValue(priorityKey, 0);
+        const String affinity = settings.getValue(affinityKey).removeCharacters(" ");
+
+       #if JUCE_LINUX
+        if (policy.priority != 0)
+        {
+            const int minimum = sched_get_priority_min(SCHED_FIFO), maximum = sched_get_priority_max(SCHED_FIFO);
+            if (policy.priority < minimum || policy.priority > maximum)
+            {
+                problems.add(priorityKey + " " + String(policy.priority) + " is outside " + String(minimum) + "-"
+                             + String(maximum) + ", " + name + " threads keep their priority");
+                policy.priority = 0;
+            }
+
+            // Checked up front so the report can say what to change instead of just EPERM
+            struct rlimit limit;
+            if (policy.priority > 0 && geteuid() != 0 && getrlimit(RLIMIT_RTPRIO, &limit) == 0
+                && limit.rlim_cur != RLIM_INFINITY && static_cast<rlim_t>(policy.priority) > limit.rlim_cur)
+            {
+                problems.add(priorityKey + " " + String(policy.priority) + " exceeds the realtime priority limit of "
+                             + String(static_cast<int64>(limit.rlim_cur)) + ", raise rtprio in /etc/security/limits.conf");
+            }
+        }
+
+        // A list of CPUs such as "2,3" or "2-3", usually ones kept free with isolcpus
+        CPU_ZERO(&policy.cpus);
+        for (const auto& range : StringArray::fromTokens(affinity, ",", ""))
+        {
+            const int first = range.upToFirstOccurrenceOf("-", false, false).getIntValue();
+            const int last = range.containsChar('-') ? range.fromFirstOccurrenceOf("-", false, false).getIntValue() : first;
+            if (!range.containsOnly("0123456789-") || first < 0 || last < first || last >= CPU_SETSIZE)
+            {
+                problems.add(affinityKey + " \"" + affinity + "\" is not a list of CPUs, " + name + " threads are not pinned");
+                CPU_ZERO(&policy.cpus);
+                break;
+            }
+
+            for (int cpu = first; cpu <= last; cpu++)
+                CPU_SET(cpu, &policy.cpus);
+        }
+        policy.pinned = CPU_COUNT(&policy.cpus) > 0;
+       #else
+        ignoreUnused(name);
+        if (policy.priority != 0 || affinity.isNotEmpty())
+            problems.add(priorityKey + " and " + affinityKey + " are only supported on Linux");
+        policy.priority = 0;
+       #endif
+    }
+
+    void applyPolicy(ThreadPolicy& policy) noexcept
+    {
+        if (!configured.load(std::memory_order_acquire))
+            return;
+
+       #if JUCE_LINUX
+        if (policy.priority > 0)
+        {
+            sched_param parameters {};
+            parameters.sched_priority = policy.priority;
+            const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+            if (result != 0)
+                policy.schedulingError = result;
+        }
+
+        if (policy.pinned)
+        {
+            const int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &policy.cpus);
+            if (result != 0)
+                policy.affinityError = result;
+        }
+       #else
+        ignoreUnused(policy);
+       #endif
+    }
+
+    void collectErrors(ThreadPolicy& policy, const String& name)
+    {
+        if (const int error = policy.schedulingError.exchange(0))
+            problems.add("Unable to run " + name + " threads with SCHED_FIFO priority " + String(policy.priority) + ": "
+                         + String(strerror(error)));
+
+        if (const int error = policy.affinityError.exchange(0))
+            problems.add("Unable to pin " + name + " threads to their CPUs: " + String(strerror(error)));
+    }
+}
+
+void RealtimePolicy::configure(PropertiesFile& settings)
+{
+    parsePolicy(settings, "audio", "realtimePriority", "realtimeAffinity", audioPolicy);
+    parsePolicy(settings, "worker", "workerPriority", "workerAffinity", workerPolicy);
+    memoryLock = static_cast<MemoryLock>(jlimit(0, 2, settings.getIntValue("lockMemory", NoLock)));
+    configured.store(true, std::memory_order_release);
+}
+
+void RealtimePolicy::lockMemory()
+{
+    if (memoryLock == NoLock)
+        return;
+
+   #if JUCE_LINUX
+    // Current locks what the chains have loaded so far, future also covers everything allocated later
+    const int flags = memoryLock == LockCurrent ? MCL_CURRENT : MCL_CURRENT | MCL_FUTURE;
+    if (mlockall(flags) != 0)
+        problems.add("Unable to lock memory: " + String(strerror(errno)) + ", raise memlock in /etc/security/limits.conf");
+   #else
+    problems.add("lockMemory is only supported on Linux");
+   #endif
+}
+
+void RealtimePolicy::applyToAudioThread() noexcept
+{
+    applyPolicy(audioPolicy);
+}
+
+void RealtimePolicy::applyToWorkerThread() noexcept
+{
+    applyPolicy(workerPolicy);
+}
+
+StringArray RealtimePolicy::takeProblems()
+{
+    collectErrors(audioPolicy, "audio");
+    collectErrors(workerPolicy, "worker");
+
+    StringArray taken;
+    taken.swapWith(problems);
+    return taken;
+}
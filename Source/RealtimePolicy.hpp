@@ -0,0 +1,33 @@
+//
+//  RealtimePolicy.hpp
+//  SoftHost
+//
+//  Optional scheduling policy for the audio path on Linux, read from the
+//  settings: SCHED_FIFO priorities and CPU affinity for the audio callback
+//  threads and for the host's worker threads, and locking the process memory
+//  so plugins are not paged out while the host idles. Audio threads apply it
+//  themselves on their first callback. Whatever could not be applied is
+//  collected and reported from the message thread.
+//
+
+#ifndef RealtimePolicy_hpp
+#define RealtimePolicy_hpp
+
+class RealtimePolicy
+{
+public:
+    // Message thread, before any audio device is opened
+    static void configure(PropertiesFile& settings);
+
+    // Message thread, once the chains and their hot scenes are loaded so their plugins are part of the locked memory
+    static void lockMemory();
+
+    // Called on the thread itself, allocation free. Audio threads call it on each first callback
+    static void applyToAudioThread() noexcept;
+    static void applyToWorkerThread() noexcept;
+
+    // Everything that failed since the last call, each problem reported once
+    static StringArray takeProblems();
+};
+
+#endif /* RealtimePolicy_hpp */
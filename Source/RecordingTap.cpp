@@ -0,0 +1,231 @@
+//
+//  RecordingTap.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RecordingTap.hpp"
+#include "RealtimePolicy.hpp"
+#include "Tracer.hpp"
+
+RecordingTap::RecordingTap(PropertiesFile& settings_)
+    : Thread("Recording Tap"),
+      settings(settings_)
+{
+    const int savedSource = settings.getIntValue("recordSource", Output);
+    source = savedSource == Input || savedSource == InputAndOutput ? static_cast<Source>(savedSource) : Output;
+    flac = settings.getValue("recordFormat").equalsIgnoreCase("flac");
+    preRollSeconds = jlimit(0, 600, settings.getIntValue("recordPreRoll", 0));
+}
+
+RecordingTap::~RecordingTap()
+{
+    stop();
+    stopThread(2000);
+}
+
+void RecordingTap::prepare(double newSampleRate)
+{
+    if (newSampleRate <= 0.0 || (newSampleRate == sampleRate && ring.getNumSamples() > 0))
+        return;
+
+    // The file keeps the rate it was started with
+    stop();
+    sampleRate = newSampleRate;
+    allocate();
+}
+
+void RecordingTap::allocate()
+{
+    const TraceScope trace("RecordingTap::allocate");
+
+    stopThread(2000);
+    {
+        const SpinLock::ScopedLockType lock(ringLock);
+        const int size = roundToInt((preRollSeconds + headroomSeconds) * sampleRate);
+        ring.setSize(2 * maxChannelsPerSide, size);
+        ring.clear();
+        chunk.setSize(2 * maxChannelsPerSide, roundToInt(sampleRate));
+        fifo.setTotalSize(size);
+        fifo.reset();
+    }
+
+    capturing = recording || preRollSeconds > 0;
+    if (capturing)
+        startThread();
+}
+
+void RecordingTap::push(const float* const* inputs, int numInputs, const float* const* outputs, int numOutputs, int numSamples) noexcept
+{
+    if (!capturing.load(std::memory_order_relaxed))
+        return;
+
+    // Only held elsewhere while the ring is reallocated, which loses the block anyway
+    const SpinLock::ScopedTryLockType lock(ringLock);
+    if (!lock.isLocked() || fifo.getFreeSpace() < numSamples)
+    {
+        if (recording.load(std::memory_order_relaxed))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    auto copySide = [&] (int firstRingChannel, const float* const* channels, int numChannels)
+    {
+        for (int channel = 0; channel < maxChannelsPerSide; channel++)
+        {
+            // Mono sides are recorded on both channels
+            const float* data = numChannels > 0 && channels != nullptr ? channels[jmin(channel, numChannels - 1)] : nullptr;
+            const int ringChannel = firstRingChannel + channel;
+
+            if (data == nullptr)
+            {
+                ring.clear(ringChannel, start1, size1);
+                if (size2 > 0)
+                    ring.clear(ringChannel, start2, size2);
+                continue;
+            }
+
+            ring.copyFrom(ringChannel, start1, data, size1);
+            if (size2 > 0)
+                ring.copyFrom(ringChannel, start2, data + size1, size2);
+        }
+    };
+
+    copySide(0, inputs, numInputs);
+    copySide(maxChannelsPerSide, outputs, numOutputs);
+    fifo.finishedWrite(size1 + size2);
+}
+
+String RecordingTap::start(const File& newFile)
+{
+    if (recording)
+        return "A recording is already running";
+    if (sampleRate <= 0.0)
+        return "The audio device is not running";
+
+    AudioFormat* format = flac ? static_cast<AudioFormat*>(&flacFormat) : &wavFormat;
+    const int numChannels = source == InputAndOutput ? 2 * maxChannelsPerSide : maxChannelsPerSide;
+
+    // Buffered so the writer thread ends up issuing large sequential writes
+    newFile.deleteFile();
+    std::unique_ptr<OutputStream> stream(newFile.createOutputStream(1 << 20));
+    std::unique_ptr<AudioFormatWriter> newWriter;
+    if (stream != nullptr)
+        newWriter.reset(format->createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels), 24, {}, 0));
+
+    if (newWriter == nullptr)
+        return "Unable to write " + newFile.getFullPathName();
+    stream.release(); // Owned by the writer now
+
+    {
+        const ScopedLock sl(writerLock);
+        writer = std::move(newWriter);
+        file = newFile;
+        firstFileChannel = source == Output ? maxChannelsPerSide : 0;
+        dropped = 0;
+        written = 0;
+        recording = true;
+    }
+
+    capturing = true;
+    if (!isThreadRunning())
+        startThread();
+    return {};
+}
+
+File RecordingTap::stop()
+{
+    if (!recording)
+        return {};
+
+    recording = false;
+    capturing = preRollSeconds > 0;
+
+    {
+        // Blocks pushed while this drains are written as well, the file just ends a little later
+        const ScopedLock sl(writerLock);
+        drain();
+        writer.reset();
+    }
+
+    if (!capturing)
+        stopThread(2000);
+    return file;
+}
+
+void RecordingTap::setSource(Source newSource)
+{
+    if (recording)
+        return;
+
+    source = newSource;
+    settings.setValue("recordSource", static_cast<int>(source));
+}
+
+void RecordingTap::setUsingFlac(bool shouldUseFlac)
+{
+    if (recording)
+        return;
+
+    flac = shouldUseFlac;
+    settings.setValue("recordFormat", flac ? "flac" : "wav");
+}
+
+void RecordingTap::setPreRollSeconds(int seconds)
+{
+    if (recording || seconds == preRollSeconds)
+        return;
+
+    preRollSeconds = jlimit(0, 600, seconds);
+    settings.setValue("recordPreRoll", preRollSeconds);
+    if (sampleRate > 0.0)
+        allocate();
+}
+
+void RecordingTap::run()
+{
+    RealtimePolicy::applyToWorkerThread();
+
+    while (!threadShouldExit())
+    {
+        drain();
+        wait(50);
+    }
+}
+
+void RecordingTap::drain()
+{
+    const ScopedLock sl(writerLock);
+    int ready = fifo.getNumReady();
+
+    if (writer == nullptr)
+    {
+        // Between recordings only the pre-roll is kept
+        const int excess = ready - roundToInt(preRollSeconds * sampleRate);
+        if (excess > 0)
+            fifo.finishedRead(excess);
+        return;
+    }
+
+    const int numChannels = static_cast<int>(writer->getNumChannels());
+    while (ready > 0)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(jmin(ready, chunk.getNumSamples()), start1, size1, start2, size2);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            chunk.copyFrom(channel, 0, ring, firstFileChannel + channel, start1, size1);
+            if (size2 > 0)
+                chunk.copyFrom(channel, size1, ring, firstFileChannel + channel, start2, size2);
+        }
+        fifo.finishedRead(size1 + size2);
+
+        writer->writeFromAudioSampleBuffer(chunk, 0, size1 + size2);
+        written += size1 + size2;
+        ready -= size1 + size2;
+    }
+}
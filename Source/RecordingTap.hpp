@@ -0,0 +1,82 @@
+//
+//  RecordingTap.hpp
+//  SoftHost
+//
+//  Records what a chain receives and what it produces. The audio thread
+//  copies each block into a preallocated ring buffer and never waits for
+//  anything, a block that does not fit is dropped and counted. A writer
+//  thread drains the ring into a WAV or FLAC file one large chunk at a time.
+//  With a pre-roll set, the ring holds on to the last seconds before the
+//  recording starts and they become the beginning of the file.
+//
+
+#ifndef RecordingTap_hpp
+#define RecordingTap_hpp
+
+class RecordingTap : private Thread
+{
+public:
+    enum Source
+    {
+        Input = 1,
+        Output = 2,
+        InputAndOutput = Input | Output
+    };
+
+    explicit RecordingTap(PropertiesFile& settings);
+    ~RecordingTap() override;
+
+    // Before the device starts streaming. A running recording ends when the sample rate changes
+    void prepare(double sampleRate);
+
+    // Audio thread, up to two channels of each side are kept
+    void push(const float* const* inputs, int numInputs, const float* const* outputs, int numOutputs, int numSamples) noexcept;
+
+    // Returns an error message, or an empty string once the file is being written
+    String start(const File& file);
+    File stop();
+    bool isRecording() const noexcept { return recording; }
+    double getSecondsRecorded() const noexcept { return sampleRate > 0.0 ? written / sampleRate : 0.0; }
+    int64 getNumDropped() const noexcept { return dropped; }
+
+    // Only changed between recordings
+    Source getSource() const noexcept { return source; }
+    void setSource(Source newSource);
+    bool isUsingFlac() const noexcept { return flac; }
+    void setUsingFlac(bool shouldUseFlac);
+    int getPreRollSeconds() const noexcept { return preRollSeconds; }
+    void setPreRollSeconds(int seconds);
+    String getFileExtension() const { return flac ? ".flac" : ".wav"; }
+
+private:
+    static const int maxChannelsPerSide = 2;
+    static const int headroomSeconds = 4;
+
+    void run() override;
+    void allocate();
+    void drain();
+
+    PropertiesFile& settings;
+    Source source = Output;
+    bool flac = false;
+    int preRollSeconds = 0;
+    double sampleRate = 0.0;
+
+    // Input channels first, then output channels
+    AudioBuffer<float> ring, chunk;
+    AbstractFifo fifo { 1 };
+    SpinLock ringLock;
+    std::atomic<bool> capturing { false }, recording { false };
+    std::atomic<int64> dropped { 0 }, written { 0 };
+
+    CriticalSection writerLock;
+    std::unique_ptr<AudioFormatWriter> writer;
+    File file;
+    int firstFileChannel = 0;
+    WavAudioFormat wavFormat;
+    FlacAudioFormat flacFormat;
+
+    JUCE_DECLARE_NON_COPYABLE(RecordingTap)
+};
+
+#endif /* RecordingTap_hpp */
@@ -0,0 +1,87 @@
+//
+//  Scene.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Scene.hpp"
+#include "Tracer.hpp"
+
+const String Scene::defaultName("Default");
+
+Scene::Scene(const String& name_, AudioPluginFormatManager& formatManager, PropertiesFile& settings_)
+    : name(name_),
+      settings(settings_),
+      chain(formatManager, activePluginList, settings_, getKeyPrefix(name_))
+{
+    chain.restoreActivePluginList();
+    activePluginList.addChangeListener(this);
+}
+
+Scene::~Scene()
+{
+    activePluginList.removeChangeListener(this);
+}
+
+String Scene::getKeyPrefix(const String& name)
+{
+    return name == defaultName ? String() : "scene-" + name + "-";
+}
+
+String Scene::getActiveName(PropertiesFile& settings, bool useCommandLine)
+{
+    if (useCommandLine)
+        for (const auto& param : JUCEApplicationBase::getCommandLineParameterArray())
+            if (param.startsWith("-scene="))
+                return param.fromFirstOccurrenceOf("=", false, false).unquoted();
+
+    std::unique_ptr<XmlElement> savedScenes(settings.getXmlValue("scenes"));
+    if (savedScenes != nullptr)
+        return savedScenes->getStringAttribute("active", defaultName);
+    return defaultName;
+}
+
+bool Scene::exists(PropertiesFile& settings, const String& name)
+{
+    if (name == defaultName)
+        return true;
+
+    std::unique_ptr<XmlElement> savedScenes(settings.getXmlValue("scenes"));
+    if (savedScenes != nullptr)
+        for (auto* element : savedScenes->getChildWithTagNameIterator("SCENE"))
+            if (element->getStringAttribute("name") == name)
+                return true;
+    return false;
+}
+
+void Scene::load(double sampleRate, int blockSize)
+{
+    const TraceScope trace("Load Scene");
+    chain.build(graph, sampleRate, blockSize);
+    loaded = true;
+}
+
+void Scene::unload()
+{
+    if (!loaded)
+        return;
+
+    const TraceScope trace("Unload Scene");
+    chain.saveStates(graph);
+    graph.releaseResources();
+    graph.clear();
+    loaded = false;
+}
+
+void Scene::saveStates()
+{
+    if (loaded)
+        chain.saveStates(graph);
+}
+
+void Scene::changeListenerCallback(ChangeBroadcaster*)
+{
+    chain.saveActivePluginList();
+    const TraceScope trace("saveIfNeeded");
+    settings.saveIfNeeded();
+}
@@ -0,0 +1,62 @@
+//
+//  Scene.hpp
+//  SoftHost
+//
+//  A named chain with its own plugin list, states and bypass flags. The
+//  default scene keeps the original settings keys, every other scene prefixes
+//  them with its name. A loaded scene owns live plugin instances in its graph.
+//
+
+#ifndef Scene_hpp
+#define Scene_hpp
+
+#include "PluginChain.hpp"
+
+class Scene : private ChangeListener
+{
+public:
+    Scene(const String& name, AudioPluginFormatManager& formatManager, PropertiesFile& settings);
+    ~Scene() override;
+
+    static const String defaultName;
+    static String getKeyPrefix(const String& name);
+
+    // -scene=<name> on the command line wins over the saved active scene, for the main chain's settings only
+    static String getActiveName(PropertiesFile& settings, bool useCommandLine = true);
+
+    // True for the default scene and for any scene in the saved list
+    static bool exists(PropertiesFile& settings, const String& name);
+
+    const String& getName() const noexcept { return name; }
+    KnownPluginList& getActivePluginList() noexcept { return activePluginList; }
+    PluginChain& getChain() noexcept { return chain; }
+    AudioProcessorGraph& getGraph() noexcept { return graph; }
+
+    bool isHot() const noexcept { return hot; }
+    void setHot(bool shouldBeHot) noexcept { hot = shouldBeHot; }
+    bool isLoaded() const noexcept { return loaded; }
+
+    // Message thread only, from the moment a background load is queued until the scene is prepared
+    bool isLoadQueued() const noexcept { return loadQueued; }
+    void setLoadQueued(bool queued) noexcept { loadQueued = queued; }
+
+    // load() may run on a background thread, plugins are created through the message thread
+    void load(double sampleRate, int blockSize);
+    void unload();
+    void saveStates();
+
+private:
+    void changeListenerCallback(ChangeBroadcaster* changed) override;
+
+    const String name;
+    PropertiesFile& settings;
+    KnownPluginList activePluginList;
+    PluginChain chain;
+    AudioProcessorGraph graph;
+    bool hot = false, loadQueued = false;
+    std::atomic<bool> loaded { false };
+
+    JUCE_DECLARE_NON_COPYABLE(Scene)
+};
+
+#endif /* Scene_hpp */
@@ -0,0 +1,402 @@
+//
+//  SceneSwitcher.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SceneSwitcher.hpp"
+#include "PluginSlot.hpp"
+#include "RealtimePolicy.hpp"
+#include "Tracer.hpp"
+
+SceneSwitcher::SceneSwitcher(AudioPluginFormatManager& formatManager_, PropertiesFile& settings_)
+    : AudioProcessor(BusesProperties().withInput("Input", AudioChannelSet::stereo(), true)
+                                      .withOutput("Output", AudioChannelSet::stereo(), true)),
+      formatManager(formatManager_),
+      settings(settings_)
+{
+}
+
+SceneSwitcher::~SceneSwitcher()
+{
+    stopTimer();
+
+    // A load in progress stops at its next plugin, or while it waits for the message thread to create one
+    shuttingDown = true;
+    loader.removeAllJobs(true, 30000);
+}
+
+void SceneSwitcher::restore(bool isMainChain)
+{
+    scenes.add(createScene(Scene::defaultName));
+
+    std::unique_ptr<XmlElement> savedScenes(settings.getXmlValue("scenes"));
+    if (savedScenes != nullptr)
+    {
+        for (auto* element : savedScenes->getChildWithTagNameIterator("SCENE"))
+        {
+            const String name = element->getStringAttribute("name");
+            if (name.isEmpty())
+                continue;
+
+            int index = indexOf(name);
+            if (index < 0)
+            {
+                index = scenes.size();
+                scenes.add(createScene(name));
+            }
+            scenes.getUnchecked(index)->setHot(element->getBoolAttribute("hot", false));
+        }
+    }
+
+    // The active scene is loaded right away, the other hot ones follow in the background
+    activeIndex = jmax(0, indexOf(Scene::getActiveName(settings, isMainChain)));
+    Scene& active = getActiveScene();
+    active.load(getLoadSampleRate(), getLoadBlockSize());
+    prepareScene(active);
+    activeGraph = &active.getGraph();
+
+    for (int i = 0; i < scenes.size(); i++)
+        if (i != activeIndex && scenes.getUnchecked(i)->isHot())
+            loadInBackground(i);
+}
+
+int SceneSwitcher::indexOf(const String& name) const
+{
+    for (int i = 0; i < scenes.size(); i++)
+        if (scenes.getUnchecked(i)->getName() == name)
+            return i;
+    return -1;
+}
+
+bool SceneSwitcher::isLoading(int index) const noexcept
+{
+    Scene* scene = scenes[index];
+    return index == loadingIndex || (scene != nullptr && scene->isLoadQueued());
+}
+
+void SceneSwitcher::switchTo(int index)
+{
+    if (!isPositiveAndBelow(index, scenes.size()))
+        return;
+
+    if (index == activeIndex)
+    {
+        // Cancels a cold scene that is still loading
+        loadingIndex = -1;
+        return;
+    }
+
+    // A scene still loading, hot ones included, is activated when its load is done
+    Scene* scene = scenes.getUnchecked(index);
+    if (scene->isLoaded() && !scene->isLoadQueued())
+    {
+        loadingIndex = -1;
+        activate(index);
+    }
+    else
+    {
+        loadingIndex = index;
+        if (!scene->isLoadQueued())
+            loadInBackground(index);
+    }
+}
+
+void SceneSwitcher::setHot(int index, bool shouldBeHot)
+{
+    Scene* scene = scenes[index];
+    if (scene == nullptr)
+        return;
+
+    scene->setHot(shouldBeHot);
+    saveSceneList();
+
+    if (shouldBeHot && !scene->isLoaded() && !scene->isLoadQueued())
+        loadInBackground(index);
+    else if (!shouldBeHot)
+        startTimer(50);
+}
+
+Scene* SceneSwitcher::createScene(const String& name)
+{
+    auto* scene = new Scene(name, formatManager, settings);
+    scene->getChain().setChainInputLevel(&inputLevel);
+    scene->getChain().setMeteringFlag(&metering);
+    scene->getChain().setAbortFlag(&shuttingDown);
+    return scene;
+}
+
+void SceneSwitcher::addScene(const String& name)
+{
+    if (name.isEmpty() || indexOf(name) >= 0)
+        return;
+
+    // New scenes start as a copy of the active one
+    auto* scene = createScene(name);
+    getActiveScene().saveStates();
+    getActiveScene().getChain().copySettingsTo(scene->getChain());
+
+    {
+        const ScopedLock sl(getCallbackLock());
+        scenes.add(scene);
+    }
+    saveSceneList();
+}
+
+void SceneSwitcher::removeScene(int index)
+{
+    // The default scene owns the original keys and always stays
+    if (!canRemove(index) || index >= scenes.size())
+        return;
+
+    Scene* scene = scenes.getUnchecked(index);
+    scene->unload();
+    scene->getChain().deleteSettings();
+
+    {
+        const ScopedLock sl(getCallbackLock());
+        scenes.remove(index);
+    }
+
+    if (activeIndex > index)
+        activeIndex--;
+    saveSceneList();
+}
+
+void SceneSwitcher::saveStates()
+{
+    for (auto* scene : scenes)
+        scene->saveStates();
+}
+
+void SceneSwitcher::loadInBackground(int index)
+{
+    Scene* scene = scenes.getUnchecked(index);
+    scene->setLoadQueued(true);
+    numPendingLoads++;
+
+    const double sampleRate = getLoadSampleRate();
+    const int blockSize = getLoadBlockSize();
+    WeakReference<AudioProcessor> weakThis(this);
+
+    loader.addJob([weakThis, scene, sampleRate, blockSize]
+    {
+        RealtimePolicy::applyToWorkerThread();
+        scene->load(sampleRate, blockSize);
+
+        MessageManager::callAsync([weakThis, scene]
+        {
+            auto* self = static_cast<SceneSwitcher*>(weakThis.get());
+            if (self == nullptr)
+                return;
+
+            self->numPendingLoads--;
+            const int index = self->scenes.indexOf(scene);
+            self->prepareScene(*scene);
+            scene->setLoadQueued(false);
+
+            if (index >= 0 && index == self->loadingIndex)
+            {
+                self->loadingIndex = -1;
+                self->activate(index);
+            }
+            else
+            {
+                // Unloads it again if it was cold and is no longer wanted
+                self->startTimer(50);
+            }
+        });
+    });
+}
+
+void SceneSwitcher::activate(int index)
+{
+    const TraceScope trace("Activate Scene");
+
+    if (onSceneChanging != nullptr)
+        onSceneChanging();
+
+    // A hot scene has been idle, don't let it resume old tails
+    Scene& scene = *scenes.getUnchecked(index);
+    scene.getGraph().reset();
+
+    activeIndex = index;
+    pendingGraph = &scene.getGraph();
+    saveSceneList();
+
+    timerTicks = 0;
+    startTimer(50);
+}
+
+void SceneSwitcher::timerCallback()
+{
+    // The audio thread takes the pending graph at its next block, when the device is stopped it is done here
+    if (pendingGraph.load() != nullptr && ++timerTicks < 10)
+        return;
+
+    stopTimer();
+
+    {
+        // Also waits for a block that is still fading out the previous graph
+        const ScopedLock sl(getCallbackLock());
+        if (auto* graph = pendingGraph.exchange(nullptr))
+            activeGraph = graph;
+    }
+
+    for (int i = 0; i < scenes.size(); i++)
+    {
+        Scene* scene = scenes.getUnchecked(i);
+        if (i != activeIndex && i != loadingIndex && !scene->isHot() && !scene->isLoadQueued())
+            scene->unload();
+    }
+}
+
+void SceneSwitcher::prepareScene(Scene& scene)
+{
+    if (getSampleRate() <= 0.0 || !scene.isLoaded())
+        return;
+
+    const TraceScope trace("Prepare Scene");
+    const double sampleRate = getSampleRate();
+    const int blockSize = getBlockSize();
+    AudioProcessorGraph& graph = scene.getGraph();
+
+    // The graph only re-prepares its nodes after a release, do it first so the slots below see the change
+    if (graph.getSampleRate() != sampleRate || graph.getBlockSize() != blockSize)
+        graph.releaseResources();
+
+    // Prepares the slots side by side first, the graph's own pass then finds them ready and only rebuilds.
+    // Instances and their state are kept, a device change never recreates a plugin.
+    Array<PluginSlot*> serial;
+    std::atomic<int> remaining { 1 };
+    WaitableEvent finished;
+
+    for (auto* node : graph.getNodes())
+    {
+        auto* slot = dynamic_cast<PluginSlot*>(node->getProcessor());
+        if (slot == nullptr)
+            continue;
+
+        if (!slot->canPrepareConcurrently())
+        {
+            serial.add(slot);
+            continue;
+        }
+
+        remaining++;
+        preparer.addJob([slot, sampleRate, blockSize, &remaining, &finished]
+        {
+            RealtimePolicy::applyToWorkerThread();
+            slot->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            slot->prepareToPlay(sampleRate, blockSize);
+            if (--remaining == 0)
+                finished.signal();
+        });
+    }
+
+    for (auto* slot : serial)
+    {
+        slot->setRateAndBufferSizeDetails(sampleRate, blockSize);
+        slot->prepareToPlay(sampleRate, blockSize);
+    }
+
+    if (--remaining > 0)
+        finished.wait();
+
+    graph.setPlayConfigDetails(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate, blockSize);
+    graph.prepareToPlay(sampleRate, blockSize);
+}
+
+void SceneSwitcher::saveSceneList()
+{
+    XmlElement savedScenes("SCENES");
+    savedScenes.setAttribute("active", getActiveScene().getName());
+    for (auto* scene : scenes)
+    {
+        auto* element = savedScenes.createNewChildElement("SCENE");
+        element->setAttribute("name", scene->getName());
+        element->setAttribute("hot", scene->isHot());
+    }
+    settings.setValue("scenes", &savedScenes);
+
+    const TraceScope trace("saveIfNeeded");
+    settings.saveIfNeeded();
+}
+
+void SceneSwitcher::prepareToPlay(double, int maximumExpectedSamplesPerBlock)
+{
+    // Room for the incoming scene while both run during a crossfade
+    scratch.setSize(jmax(2, getTotalNumInputChannels(), getTotalNumOutputChannels()), maximumExpectedSamplesPerBlock);
+
+    // Enough for a full queue of three byte messages, so adding them never allocates
+    incomingMidi.ensureSize(MidiInputQueue::capacity * 16);
+    if (midiInput != nullptr)
+        midiInput->reset();
+
+    const ScopedLock sl(getCallbackLock());
+    for (auto* scene : scenes)
+        prepareScene(*scene);
+}
+
+void SceneSwitcher::releaseResources()
+{
+    const ScopedLock sl(getCallbackLock());
+    for (auto* scene : scenes)
+        if (scene->isLoaded())
+            scene->getGraph().releaseResources();
+}
+
+void SceneSwitcher::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    if (midiInput != nullptr)
+    {
+        incomingMidi.clear();
+        incomingMidi.addEvents(midiMessages, 0, -1, 0);
+        midiInput->removeNextBlockOfMessages(incomingMidi, buffer.getNumSamples(), getSampleRate());
+    }
+    MidiBuffer& midi = midiInput != nullptr ? incomingMidi : midiMessages;
+
+    // Taken before any plugin runs, for the envelope followers of every slot in the chain
+    float peak = 0.0f;
+    for (int channel = 0; channel < jmin(getTotalNumInputChannels(), buffer.getNumChannels()); channel++)
+        peak = jmax(peak, buffer.getMagnitude(channel, 0, buffer.getNumSamples()));
+    inputLevel.store(peak, std::memory_order_relaxed);
+
+    AudioProcessorGraph* current = activeGraph.load(std::memory_order_acquire);
+    AudioProcessorGraph* next = pendingGraph.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (next == nullptr || next == current)
+    {
+        if (current != nullptr)
+            current->processBlock(buffer, midi);
+        else
+            buffer.clear();
+        return;
+    }
+
+    const TraceScope trace("Switch Scene");
+    activeGraph.store(next, std::memory_order_release);
+
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    if (current == nullptr || numChannels > scratch.getNumChannels() || numSamples > scratch.getNumSamples())
+    {
+        next->processBlock(buffer, midi);
+        return;
+    }
+
+    // Both scenes run on the same input, the old one fades out over this block
+    AudioBuffer<float> incoming(scratch.getArrayOfWritePointers(), numChannels, numSamples);
+    for (int channel = 0; channel < numChannels; channel++)
+        incoming.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    noMidi.clear();
+    current->processBlock(buffer, noMidi);
+    next->processBlock(incoming, midi);
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        buffer.applyGainRamp(channel, 0, numSamples, 1.0f, 0.0f);
+        buffer.addFromWithRamp(channel, 0, incoming.getReadPointer(channel), numSamples, 0.0f, 1.0f);
+    }
+}
@@ -0,0 +1,102 @@
+//
+//  SceneSwitcher.hpp
+//  SoftHost
+//
+//  The processor the player runs. It owns every scene and plays the graph of
+//  the active one. Hot scenes stay loaded and prepared, so a switch is a
+//  pointer swap picked up at the next block and crossfaded within that block.
+//  Cold scenes are loaded on a background thread and unloaded once they stop
+//  being active.
+//
+
+#ifndef SceneSwitcher_hpp
+#define SceneSwitcher_hpp
+
+#include "Scene.hpp"
+#include "MidiInputQueue.hpp"
+
+class SceneSwitcher : public AudioProcessor, private Timer
+{
+public:
+    SceneSwitcher(AudioPluginFormatManager& formatManager, PropertiesFile& settings);
+    ~SceneSwitcher() override;
+
+    // Creates the saved scenes and loads the active and hot ones. -scene= on the command line only applies to the main chain
+    void restore(bool isMainChain);
+
+    int getNumScenes() const noexcept { return scenes.size(); }
+    Scene* getScene(int index) const noexcept { return scenes[index]; }
+    int indexOf(const String& name) const;
+    int getActiveIndex() const noexcept { return activeIndex; }
+    Scene& getActiveScene() const noexcept { return *scenes.getUnchecked(activeIndex); }
+    bool isLoading(int index) const noexcept;
+    bool hasPendingLoads() const noexcept { return numPendingLoads > 0; }
+    bool canRemove(int index) const noexcept { return index > 0 && index != activeIndex && numPendingLoads == 0; }
+
+    void switchTo(int index);
+    void setHot(int index, bool shouldBeHot);
+    void addScene(const String& name);
+    void removeScene(int index);
+    void saveStates();
+
+    // Plugins are created at the device settings, or at common defaults before a device has started
+    double getLoadSampleRate() const { return getSampleRate() > 0.0 ? getSampleRate() : 44100.0; }
+    int getLoadBlockSize() const { return getBlockSize() > 0 ? getBlockSize() : 512; }
+
+    // Turns on the meters of every slot in every scene of this chain
+    void setMeteringEnabled(bool shouldMeter) noexcept { metering = shouldMeter; }
+
+    // Set before the device starts, its messages are merged into every block
+    void setMidiInput(MidiInputQueue* queue) noexcept { midiInput = queue; }
+
+    // Called on the message thread before the active scene changes
+    std::function<void()> onSceneChanging;
+
+    //==============================================================================
+    const String getName() const override { return "Scenes"; }
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+    bool isBusesLayoutSupported(const BusesLayout&) const override { return true; }
+
+    double getTailLengthSeconds() const override { return 0.0; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return false; }
+    bool hasEditor() const override { return false; }
+    AudioProcessorEditor* createEditor() override { return nullptr; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const String&) override {}
+    void getStateInformation(MemoryBlock&) override {}
+    void setStateInformation(const void*, int) override {}
+
+private:
+    void timerCallback() override;
+    Scene* createScene(const String& name);
+    void loadInBackground(int index);
+    void activate(int index);
+    void prepareScene(Scene& scene);
+    void saveSceneList();
+
+    AudioPluginFormatManager& formatManager;
+    PropertiesFile& settings;
+    OwnedArray<Scene> scenes;
+    int activeIndex = 0, loadingIndex = -1, numPendingLoads = 0, timerTicks = 0;
+    ThreadPool loader { 1 };
+    ThreadPool preparer { SystemStats::getNumCpus() };
+
+    // Read by the audio thread, a pending graph replaces the active one at the next block
+    std::atomic<AudioProcessorGraph*> activeGraph { nullptr }, pendingGraph { nullptr };
+    AudioBuffer<float> scratch;
+    MidiBuffer noMidi, incomingMidi;
+    MidiInputQueue* midiInput = nullptr;
+    std::atomic<float> inputLevel { 0.0f };
+    std::atomic<bool> metering { false }, shuttingDown { false };
+
+    JUCE_DECLARE_NON_COPYABLE(SceneSwitcher)
+};
+
+#endif /* SceneSwitcher_hpp */
@@ -0,0 +1,160 @@
+//
+//  SimdKernels.hpp
+//  SoftHost
+//
+//  Small vectorised loops for the audio thread that FloatVectorOperations
+//  has no single-pass or ramped version of. SSE2 on Intel, NEON on ARM, and a plain
+//  loop everywhere else, which the compiler is free to vectorise itself.
+//
+
+#ifndef SimdKernels_hpp
+#define SimdKernels_hpp
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+namespace SimdKernels
+{
+    // Largest absolute value and sum of squares of one channel, reading it only once
+    inline void peakAndSumOfSquares(const float* data, int numSamples, float& peak, float& sumOfSquares) noexcept
+    {
+        int i = 0;
+        float blockPeak = 0.0f, blockSum = 0.0f;
+
+       #if JUCE_USE_SSE_INTRINSICS
+        // Two accumulators each, so consecutive adds do not wait on one another
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 peakA = _mm_setzero_ps(), peakB = _mm_setzero_ps();
+        __m128 sumA = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const __m128 a = _mm_loadu_ps(data + i);
+            const __m128 b = _mm_loadu_ps(data + i + 4);
+            peakA = _mm_max_ps(peakA, _mm_and_ps(a, absMask));
+            peakB = _mm_max_ps(peakB, _mm_and_ps(b, absMask));
+            sumA = _mm_add_ps(sumA, _mm_mul_ps(a, a));
+            sumB = _mm_add_ps(sumB, _mm_mul_ps(b, b));
+        }
+
+        alignas(16) float peaks[4], sums[4];
+        _mm_store_ps(peaks, _mm_max_ps(peakA, peakB));
+        _mm_store_ps(sums, _mm_add_ps(sumA, sumB));
+        blockPeak = jmax(peaks[0], peaks[1], peaks[2], peaks[3]);
+        blockSum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+       #elif JUCE_USE_ARM_NEON
+        float32x4_t peakA = vdupq_n_f32(0.0f), peakB = vdupq_n_f32(0.0f);
+        float32x4_t sumA = vdupq_n_f32(0.0f), sumB = vdupq_n_f32(0.0f);
+
+        for (; i + 8 <= numSamples; i += 8)
+        {
+            const float32x4_t a = vld1q_f32(data + i);
+            const float32x4_t b = vld1q_f32(data + i + 4);
+            peakA = vmaxq_f32(peakA, vabsq_f32(a));
+            peakB = vmaxq_f32(peakB, vabsq_f32(b));
+            sumA = vmlaq_f32(sumA, a, a);
+            sumB = vmlaq_f32(sumB, b, b);
+        }
+
+        float peaks[4], sums[4];
+        vst1q_f32(peaks, vmaxq_f32(peakA, peakB));
+        vst1q_f32(sums, vaddq_f32(sumA, sumB));
+        blockPeak = jmax(peaks[0], peaks[1], peaks[2], peaks[3]);
+        blockSum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+       #endif
+
+        for (; i < numSamples; i++)
+        {
+            blockPeak = jmax(blockPeak, std::abs(data[i]));
+            blockSum += data[i] * data[i];
+        }
+
+        peak = blockPeak;
+        sumOfSquares = blockSum;
+    }
+
+    // Multiplies by a gain moving linearly from startGain towards endGain across the block
+    inline void multiplyByRamp(float* data, int numSamples, float startGain, float endGain) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        if (startGain == endGain)
+            return FloatVectorOperations::multiply(data, startGain, numSamples);
+
+        const float step = (endGain - startGain) / static_cast<float>(numSamples);
+        int i = 0;
+
+       #if JUCE_USE_SSE_INTRINSICS
+        __m128 gain = _mm_setr_ps(startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step);
+        const __m128 increment = _mm_set1_ps(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), gain));
+            gain = _mm_add_ps(gain, increment);
+        }
+       #elif JUCE_USE_ARM_NEON
+        const float initial[4] = { startGain, startGain + step, startGain + 2.0f * step, startGain + 3.0f * step };
+        float32x4_t gain = vld1q_f32(initial);
+        const float32x4_t increment = vdupq_n_f32(4.0f * step);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), gain));
+            gain = vaddq_f32(gain, increment);
+        }
+       #endif
+
+        for (; i < numSamples; i++)
+            data[i] *= startGain + step * static_cast<float>(i);
+    }
+
+    // wet = wet * wetGain + dry * dryGain, both gains ramped linearly across the block
+    inline void mixWithRamps(float* wet, const float* dry, int numSamples,
+                             float wetStart, float wetEnd, float dryStart, float dryEnd) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        const float wetStep = (wetEnd - wetStart) / static_cast<float>(numSamples);
+        const float dryStep = (dryEnd - dryStart) / static_cast<float>(numSamples);
+        int i = 0;
+
+       #if JUCE_USE_SSE_INTRINSICS
+        __m128 wetGain = _mm_setr_ps(wetStart, wetStart + wetStep, wetStart + 2.0f * wetStep, wetStart + 3.0f * wetStep);
+        __m128 dryGain = _mm_setr_ps(dryStart, dryStart + dryStep, dryStart + 2.0f * dryStep, dryStart + 3.0f * dryStep);
+        const __m128 wetIncrement = _mm_set1_ps(4.0f * wetStep);
+        const __m128 dryIncrement = _mm_set1_ps(4.0f * dryStep);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            const __m128 mixed = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(wet + i), wetGain), _mm_mul_ps(_mm_loadu_ps(dry + i), dryGain));
+            _mm_storeu_ps(wet + i, mixed);
+            wetGain = _mm_add_ps(wetGain, wetIncrement);
+            dryGain = _mm_add_ps(dryGain, dryIncrement);
+        }
+       #elif JUCE_USE_ARM_NEON
+        const float wetInitial[4] = { wetStart, wetStart + wetStep, wetStart + 2.0f * wetStep, wetStart + 3.0f * wetStep };
+        const float dryInitial[4] = { dryStart, dryStart + dryStep, dryStart + 2.0f * dryStep, dryStart + 3.0f * dryStep };
+        float32x4_t wetGain = vld1q_f32(wetInitial), dryGain = vld1q_f32(dryInitial);
+        const float32x4_t wetIncrement = vdupq_n_f32(4.0f * wetStep);
+        const float32x4_t dryIncrement = vdupq_n_f32(4.0f * dryStep);
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            vst1q_f32(wet + i, vmlaq_f32(vmulq_f32(vld1q_f32(wet + i), wetGain), vld1q_f32(dry + i), dryGain));
+            wetGain = vaddq_f32(wetGain, wetIncrement);
+            dryGain = vaddq_f32(dryGain, dryIncrement);
+        }
+       #endif
+
+        for (; i < numSamples; i++)
+            wet[i] = wet[i] * (wetStart + wetStep * static_cast<float>(i)) + dry[i] * (dryStart + dryStep * static_cast<float>(i));
+    }
+}
+
+#endif /* SimdKernels_hpp */
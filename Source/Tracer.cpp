@@ -0,0 +1,204 @@
+//
+//  Tracer.cpp
+//  SoftHost
+//
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Tracer.hpp"
+
+namespace
+{
+    // The first buffers are kept for audio threads, which a restarted device recreates. The rest covers the
+    // message thread, the scene loader, a preparer per core and render workers. Unused buffers are never touched,
+    // so the OS only backs the ones threads actually write
+    const int maxAudioThreads = 8;
+    const int maxThreads = maxAudioThreads + 56;
+    const uint32 eventsPerThread = 1 << 17;
+
+    struct Event
+    {
+        int64 ticks;
+        const char* name;
+        int64 id;
+        char phase;
+    };
+
+    struct ThreadBuffer
+    {
+        HeapBlock<Event> events;
+        std::atomic<uint32> writeIndex { 0 };
+        bool isMessageThread = false, isAudioThread = false;
+    };
+
+    // Allocated once on the first start() and kept for the lifetime of the process,
+    // so a thread that is still recording can never write into freed memory
+    ThreadBuffer threadBuffers[maxThreads];
+    std::atomic<bool> recording { false };
+    std::atomic<int> nextAudioBuffer { 0 }, nextThreadBuffer { maxAudioThreads };
+    std::atomic<uint32> generation { 0 };
+    std::atomic<int64> nextId { 0 };
+    int64 startTicks = 0;
+
+    // Events from threads beyond maxThreads have nowhere to go, they are only counted
+    std::atomic<int64> droppedEvents { 0 };
+    std::atomic<int> droppedThreads { 0 };
+
+    thread_local bool isAudioThread = false;
+
+    CriticalSection labelLock;
+    HashMap<int64, String> labels;
+
+    String escape(const String& text)
+    {
+        return text.replace("\\", "\\\\").replace("\"", "\\\"");
+    }
+}
+
+void Tracer::start()
+{
+    if (recording)
+        return;
+
+    for (auto& buffer : threadBuffers)
+    {
+        if (buffer.events == nullptr)
+            buffer.events.malloc(eventsPerThread);
+        buffer.writeIndex = 0;
+        buffer.isMessageThread = false;
+        buffer.isAudioThread = false;
+    }
+
+    nextAudioBuffer = 0;
+    nextThreadBuffer = maxAudioThreads;
+    droppedEvents = 0;
+    droppedThreads = 0;
+    ++generation;
+    startTicks = Time::getHighResolutionTicks();
+    recording = true;
+}
+
+void Tracer::stop()
+{
+    recording = false;
+}
+
+void Tracer::setAudioThread() noexcept
+{
+    isAudioThread = true;
+}
+
+bool Tracer::isRecording() noexcept
+{
+    return recording.load(std::memory_order_relaxed);
+}
+
+void Tracer::record(char phase, const char* name, int64 id) noexcept
+{
+    if (!recording.load(std::memory_order_relaxed))
+        return;
+
+    thread_local ThreadBuffer* buffer = nullptr;
+    thread_local uint32 claimedGeneration = 0;
+
+    const uint32 currentGeneration = generation.load(std::memory_order_acquire);
+    if (claimedGeneration != currentGeneration)
+    {
+        // Audio threads take their own buffers first and share the others once those run out
+        int index = isAudioThread ? nextAudioBuffer.fetch_add(1) : maxAudioThreads;
+        if (index >= maxAudioThreads)
+            index = nextThreadBuffer.fetch_add(1);
+
+        buffer = index < maxThreads ? &threadBuffers[index] : nullptr;
+        claimedGeneration = currentGeneration;
+
+        if (buffer != nullptr)
+        {
+            buffer->isMessageThread = MessageManager::existsAndIsCurrentThread();
+            buffer->isAudioThread = isAudioThread;
+        }
+        else
+        {
+            ++droppedThreads;
+        }
+    }
+
+    if (buffer == nullptr)
+    {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint32 index = buffer->writeIndex.load(std::memory_order_relaxed);
+    Event& event = buffer->events[index & (eventsPerThread - 1)];
+    event.ticks = Time::getHighResolutionTicks();
+    event.name = name;
+    event.id = id;
+    event.phase = phase;
+    buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+int64 Tracer::createId(const String& label)
+{
+    const int64 id = nextId++;
+    const ScopedLock sl(labelLock);
+    labels.set(id, label);
+    return id;
+}
+
+bool Tracer::writeChromeTrace(const File& file)
+{
+    file.deleteFile();
+    FileOutputStream out(file);
+    if (out.failedToOpen())
+        return false;
+
+    const double ticksPerMicrosecond = Time::getHighResolutionTicksPerSecond() / 1.0e6;
+    const int numThreads = jmin(nextThreadBuffer.load(), maxThreads);
+    bool first = true;
+    int64 overwrittenEvents = 0;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        const ThreadBuffer& buffer = threadBuffers[thread];
+        const uint32 end = buffer.writeIndex.load(std::memory_order_acquire);
+        const uint32 begin = end > eventsPerThread ? end - eventsPerThread : 0;
+        overwrittenEvents += begin;
+        if (begin == end)
+            continue;
+
+        // Threads are named after the message thread, the audio thread or the first thing they recorded
+        const String threadName = buffer.isMessageThread ? String("Message Thread")
+                                : buffer.isAudioThread ? String("Audio Thread")
+                                : String(buffer.events[begin & (eventsPerThread - 1)].name) + " Thread";
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << (thread + 1)
+            << ",\"args\":{\"name\":\"" << escape(threadName) << "\"}}";
+        first = false;
+
+        for (uint32 i = begin; i != end; i++)
+        {
+            const Event& event = buffer.events[i & (eventsPerThread - 1)];
+            String name(event.name);
+            if (event.id >= 0)
+            {
+                const ScopedLock sl(labelLock);
+                if (labels.contains(event.id))
+                    name << ": " << labels[event.id];
+            }
+
+            out << ",\n{\"name\":\"" << escape(name) << "\",\"ph\":\"" << String::charToString(event.phase)
+                << "\",\"ts\":" << String((event.ticks - startTicks) / ticksPerMicrosecond, 3)
+                << ",\"pid\":1,\"tid\":" << (thread + 1);
+            if (event.phase == 'i')
+                out << ",\"s\":\"t\"";
+            out << "}";
+        }
+    }
+
+    // Shown under the trace's metadata, so a trace with gaps says so
+    out << "\n],\"otherData\":{\"droppedThreads\":" << droppedThreads.load()
+        << ",\"droppedEvents\":" << droppedEvents.load() << ",\"overwrittenEvents\":" << overwrittenEvents << "}}\n";
+    out.flush();
+    return out.getStatus().wasOk();
+}
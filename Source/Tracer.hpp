@@ -0,0 +1,58 @@
+//
+//  Tracer.hpp
+//  SoftHost
+//
+//  Lightweight event tracer. Every thread records into its own preallocated
+//  ring buffer, so recording never allocates or locks, and is safe on the
+//  audio thread. Traces are written in the Chrome trace event format, which
+//  chrome://tracing and the Perfetto UI both open. Audio callback threads have
+//  buffers of their own, so a pool full of worker threads never silences
+//  them. Events that found no room are counted and listed in the trace's
+//  metadata.
+//
+
+#ifndef Tracer_hpp
+#define Tracer_hpp
+
+class Tracer
+{
+public:
+    static void start();
+    static void stop();
+    static bool isRecording() noexcept;
+
+    // Names must be string literals, only the pointer is stored
+    static void record(char phase, const char* name, int64 id = -1) noexcept;
+
+    // Called once by every audio callback thread, it then records into the buffers kept for audio threads
+    static void setAudioThread() noexcept;
+    static void instant(const char* name, int64 id = -1) noexcept { record('i', name, id); }
+
+    static int64 createId(const String& label);
+    static bool writeChromeTrace(const File& file);
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name_, int64 id_ = -1) noexcept
+        : name(Tracer::isRecording() ? name_ : nullptr), id(id_)
+    {
+        if (name != nullptr)
+            Tracer::record('B', name, id);
+    }
+
+    ~TraceScope()
+    {
+        if (name != nullptr)
+            Tracer::record('E', name, id);
+    }
+
+private:
+    const char* const name;
+    const int64 id;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceScope)
+};
+
+#endif /* Tracer_hpp */